@@ -0,0 +1,103 @@
+# Measures compile time and object size of a concrete factory with N products
+# for chained (concrete_factory) and flat (flat_concrete_factory) creators.
+#
+# cmake -DCXX=<compiler> -DCXX_ID=<compiler id> -DSOURCE_DIR=<repo>
+#       -DWORK_DIR=<dir> [-DPRODUCT_COUNTS=10;100;500;1000]
+#       -P compile_time_benchmark.cmake
+
+if (NOT PRODUCT_COUNTS)
+	set(PRODUCT_COUNTS 10 100 500 1000)
+endif()
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+if (CXX_ID STREQUAL "MSVC")
+	set(COMPILE_FLAGS /nologo /std:c++14 /O2 /c "/I${SOURCE_DIR}")
+	set(OUTPUT_FLAG "/Fo")
+else()
+	set(COMPILE_FLAGS -std=c++11 -O2 -c "-I${SOURCE_DIR}")
+	set(OUTPUT_FLAG "-o")
+endif()
+
+# %f (microseconds) is available since CMake 3.23, older ones give seconds
+function(now_ms result)
+	if (CMAKE_VERSION VERSION_LESS 3.23)
+		string(TIMESTAMP seconds "%s")
+		math(EXPR ms "${seconds} * 1000")
+	else()
+		string(TIMESTAMP microseconds "%s%f")
+		math(EXPR ms "${microseconds} / 1000")
+	endif()
+	set(${result} ${ms} PARENT_SCOPE)
+endfunction()
+
+function(generate_source path count mode)
+	math(EXPR last "${count} - 1")
+	set(abstracts "")
+	set(concretes "")
+	set(calls "")
+	foreach(i RANGE ${last})
+		if (i GREATER 0)
+			string(APPEND abstracts ", ")
+			string(APPEND concretes ", ")
+		endif()
+		string(APPEND abstracts "I<${i}>")
+		string(APPEND concretes "C<${i}>")
+		string(APPEND calls "\tsum += abstractFactory->create<I<${i}>>() ? 1 : 0;\n")
+	endforeach()
+
+	if (mode STREQUAL "flat")
+		set(abstract_creator ", flat_abstract_creator")
+		set(concrete_factory "flat_concrete_factory")
+	else()
+		set(abstract_creator "")
+		set(concrete_factory "concrete_factory")
+	endif()
+
+	file(WRITE "${path}" "#include \"generic_abstract_factory.h\"
+
+using namespace generic_abstract_factory;
+
+template<int N> struct I { virtual ~I() = default; };
+template<int N> struct C : public I<N> {};
+
+using AFactory = abstract_factory<utils::tl<${abstracts}>${abstract_creator}>;
+using CFactory = ${concrete_factory}<AFactory, utils::tl<${concretes}>>;
+
+int main()
+{
+\tCFactory concreteFactory;
+\tAFactory* abstractFactory = &concreteFactory;
+\tint sum = 0;
+${calls}\treturn sum;
+}
+")
+endfunction()
+
+message(STATUS "products\tmode\ttime, ms\tobject, bytes")
+foreach(count ${PRODUCT_COUNTS})
+	foreach(mode chain flat)
+		set(source "${WORK_DIR}/${mode}_${count}.cpp")
+		set(object "${WORK_DIR}/${mode}_${count}.o")
+		generate_source("${source}" ${count} ${mode})
+		file(REMOVE "${object}")
+
+		now_ms(start)
+		execute_process(
+			COMMAND "${CXX}" ${COMPILE_FLAGS} "${source}" "${OUTPUT_FLAG}${object}"
+			RESULT_VARIABLE failed
+			OUTPUT_QUIET
+			ERROR_QUIET
+		)
+		now_ms(stop)
+		math(EXPR elapsed "${stop} - ${start}")
+
+		if (failed)
+			set(size "failed")
+		else()
+			file(SIZE "${object}" size)
+		endif()
+
+		message(STATUS "${count}\t${mode}\t${elapsed}\t${size}")
+	endforeach()
+endforeach()
@@ -1,7 +1,23 @@
-﻿#include <memory>
+﻿// checks below are the example's tests, keep them in release builds
+#undef NDEBUG
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+#include <string>
+#include <typeinfo>
+#include <new>
+#include <cstdlib>
 #include <cassert>
 
 #include "generic_abstract_factory.h"
+#include "generic_abstract_factory_async.h"
+#include "generic_abstract_factory_interning.h"
+#include "generic_abstract_factory_lazy.h"
+#include "generic_abstract_factory_singleton.h"
 
 #define TYPE_ASSERT(variable, type) \
 	static_assert(std::is_same<decltype(variable), type>::value, \
@@ -9,6 +25,41 @@
 
 using namespace generic_abstract_factory;
 
+//counts all allocations made by operator new and their releases, from any thread
+std::atomic<int> heapAllocations{ 0 };
+std::atomic<int> heapReleases{ 0 };
+
+void* operator new(std::size_t size)
+{
+	++heapAllocations;
+	if (void* p = std::malloc(size ? size : 1))
+	{
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+
+// GCC flags free() of memory from operator new once it inlines the
+// replaced operator delete
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept
+{
+	heapReleases += p != nullptr;
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	heapReleases += p != nullptr;
+	std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
 struct IUniqueProduct
 {
 	virtual ~IUniqueProduct() = default;
@@ -17,6 +68,7 @@ struct IUniqueProduct
 struct ISharedProduct
 {
 	using ret_type = std::shared_ptr<ISharedProduct>;
+	using creation_features = utils::tl<batch_creation>;
 
 	virtual ~ISharedProduct() = default;
 };
@@ -25,6 +77,7 @@ struct IRawProduct
 {
 	using ret_type = IRawProduct *;
 	using ctor_args = utils::tl<bool, int>;
+	using creation_features = utils::tl<inplace_creation>;
 
 	virtual ~IRawProduct() = default;
 };
@@ -81,6 +134,187 @@ using IExistingFactoryProduct = utils::make_factory_interface<
 	IExistingSharedProduct, std::shared_ptr<IExistingSharedProduct>
 >;
 
+struct IPooledProduct
+{
+	using ret_type = block_ptr<IPooledProduct>;
+	using ctor_args = utils::tl<int>;
+	using creation_features = utils::tl<batch_creation>;
+
+	virtual int Value() const = 0;
+	virtual ~IPooledProduct() = default;
+};
+
+struct PooledProduct : public IPooledProduct
+{
+	PooledProduct(int value) : value{ value }
+	{
+	}
+
+	int Value() const override
+	{
+		return value;
+	}
+
+	int value;
+};
+
+// product that doesn't fit into inplace_poly<IUniqueProduct, 16>
+struct OversizedProduct : public IUniqueProduct
+{
+	char payload[64];
+};
+
+using IInlineProduct = utils::make_factory_interface<
+	IPooledProduct, inplace_poly<IPooledProduct, 32>, utils::tl<int>
+>;
+using IOversizedProduct = utils::make_factory_interface<
+	IUniqueProduct, inplace_poly<IUniqueProduct, 16>
+>;
+
+struct IForwardedProduct
+{
+	using ctor_args = utils::tl<std::string, std::vector<int>>;
+
+	virtual ~IForwardedProduct() = default;
+};
+
+struct ForwardedProduct : public IForwardedProduct
+{
+	ForwardedProduct(std::string name, std::vector<int> values)
+		: name{ std::move(name) }, values{ std::move(values) }
+	{
+	}
+
+	std::string name;
+	std::vector<int> values;
+};
+
+struct IRecycledProduct
+{
+	using ret_type = std::shared_ptr<IRecycledProduct>;
+	using ctor_args = utils::tl<int>;
+
+	virtual int Value() const = 0;
+	virtual ~IRecycledProduct() = default;
+};
+
+int recycledConstructions = 0;
+
+//product with expensive constructor and cheap reset()
+struct RecycledProduct : public IRecycledProduct
+{
+	RecycledProduct(int value) : buffer(1024, value)
+	{
+		++recycledConstructions;
+	}
+
+	void reset(int value)
+	{
+		std::fill(buffer.begin(), buffer.end(), value);
+	}
+
+	int Value() const override
+	{
+		return buffer.front();
+	}
+
+	std::vector<int> buffer;
+};
+
+struct IInternedProduct
+{
+	using ret_type = std::shared_ptr<const IInternedProduct>;
+	using ctor_args = utils::tl<const std::string&, int>;
+
+	virtual const std::string& Name() const = 0;
+	virtual ~IInternedProduct() = default;
+};
+
+int internedConstructions = 0;
+
+//immutable product, equal ones can be shared
+struct InternedProduct : public IInternedProduct
+{
+	InternedProduct(const std::string& name, int level) : name{ name }, level{ level }
+	{
+		++internedConstructions;
+	}
+
+	const std::string& Name() const override
+	{
+		return name;
+	}
+
+	const std::string name;
+	const int level;
+};
+
+std::vector<int> serviceDestructions;
+
+template<int N>
+struct IService
+{
+	using ret_type = typename std::conditional<
+		N == 0, IService*, std::shared_ptr<IService>
+	>::type;
+	using ctor_args = utils::tl<int>;
+
+	virtual int Value() const = 0;
+	virtual ~IService() = default;
+};
+
+template<int N>
+struct Service : public IService<N>
+{
+	Service(int value) : value{ value }
+	{
+	}
+
+	~Service() override
+	{
+		serviceDestructions.push_back(N);
+	}
+
+	int Value() const override
+	{
+		return value;
+	}
+
+	int value;
+};
+
+int countedDestructions = 0;
+
+template<typename Counter>
+struct ICountedProduct : public ref_counted<Counter>
+{
+	using ret_type = intrusive_ptr<ICountedProduct>;
+	using ctor_args = utils::tl<int>;
+
+	virtual int Value() const = 0;
+	~ICountedProduct() override
+	{
+		++countedDestructions;
+	}
+};
+
+template<typename Counter>
+struct CountedProduct : public ICountedProduct<Counter>
+{
+	CountedProduct(int value) : value{ value }
+	{
+	}
+
+	int Value() const override
+	{
+		return value;
+	}
+
+	int value;
+};
+
+using ISharedCountedProduct = ICountedProduct<atomic_ref_count>;
+using ILocalCountedProduct = ICountedProduct<local_ref_count>;
 
 //helper to detect prototype_t member
 template<typename T, typename = utils::void_t<>>
@@ -189,6 +423,232 @@ using CFactory = concrete_factory<AFactory, utils::tl<
 	CustomConcreteCreator
 >;
 
+using CompactAFactory = compact_abstract_factory<
+	utils::tl<
+		IUniqueProduct, ISharedProduct, IRawProduct,
+		IIntValue, IFloatValue,
+		PrototypeProductA::abstract_t, PrototypeProductB::abstract_t,
+		IExistingFactoryProduct
+	>
+>;
+
+using CompactCFactory = concrete_factory<CompactAFactory, utils::tl<
+		UniqueProduct, SharedProduct, RawProduct,
+		IIntValue, IFloatValue,
+		PrototypeProductA::abstract_t, PrototypeProductB::abstract_t,
+		ExistingSharedProduct
+	>,
+	CustomConcreteCreator
+>;
+
+static_assert(sizeof(CompactAFactory) == sizeof(void*),
+	"compact_abstract_factory should have single vtable pointer");
+
+using FlatAFactory = abstract_factory<
+	utils::tl<
+		IUniqueProduct, ISharedProduct, IRawProduct,
+		IIntValue, IFloatValue,
+		PrototypeProductA::abstract_t, PrototypeProductB::abstract_t,
+		IExistingFactoryProduct
+	>,
+	flat_abstract_creator
+>;
+
+using FlatCFactory = flat_concrete_factory<FlatAFactory, utils::tl<
+		UniqueProduct, SharedProduct, RawProduct,
+		IIntValue, IFloatValue,
+		PrototypeProductA::abstract_t, PrototypeProductB::abstract_t,
+		ExistingSharedProduct
+	>,
+	CustomConcreteCreator
+>;
+
+//allocator that counts allocations made through it
+int countedAllocations = 0;
+
+template<typename T>
+struct CountingAllocator
+{
+	using value_type = T;
+
+	CountingAllocator() = default;
+
+	template<typename U>
+	CountingAllocator(const CountingAllocator<U>&)
+	{
+	}
+
+	T* allocate(std::size_t n)
+	{
+		++countedAllocations;
+		return std::allocator<T>{}.allocate(n);
+	}
+
+	void deallocate(T* p, std::size_t n)
+	{
+		std::allocator<T>{}.deallocate(p, n);
+	}
+};
+
+template<typename T, typename U>
+bool operator==(const CountingAllocator<T>&, const CountingAllocator<U>&)
+{
+	return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const CountingAllocator<T>&, const CountingAllocator<U>&)
+{
+	return false;
+}
+
+template<typename... Ts>
+using CountingConcreteCreator = allocator_concrete_creator<CountingAllocator<void>, Ts...>;
+
+using SharedAFactory = abstract_factory<utils::tl<ISharedProduct, IUniqueProduct>>;
+using SharedCFactory = concrete_factory<
+	SharedAFactory, utils::tl<SharedProduct, UniqueProduct>, CountingConcreteCreator
+>;
+
+//memory resource that counts live allocations
+class CountingResource : public memory_resource
+{
+public:
+	int allocations = 0;
+
+private:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		++allocations;
+		return new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+	{
+		--allocations;
+		new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+//executor that runs tasks on the calling thread
+struct InlineExecutor
+{
+	void execute(std::function<void()> task)
+	{
+		task();
+	}
+};
+
+using PoolAFactory = abstract_factory<utils::tl<IPooledProduct, ISharedProduct>>;
+using PoolCFactory = concrete_factory<
+	PoolAFactory, utils::tl<PooledProduct, SharedProduct>, pool_concrete_creator
+>;
+using CachedPoolCFactory = concrete_factory<
+	PoolAFactory, utils::tl<PooledProduct, SharedProduct>, cached_pool_concrete_creator
+>;
+using ResourceCFactory = resource_concrete_factory<
+	PoolAFactory, utils::tl<PooledProduct, SharedProduct>
+>;
+using ArenaCFactory = arena_concrete_factory<
+	PoolAFactory, utils::tl<PooledProduct, SharedProduct>
+>;
+
+using InplaceAFactory = abstract_factory<utils::tl<IInlineProduct, IOversizedProduct>>;
+using InplaceCFactory = concrete_factory<
+	InplaceAFactory, utils::tl<PooledProduct, OversizedProduct>
+>;
+
+using InstrumentedCFactory = concrete_factory<
+	PoolAFactory,
+	utils::tl<PooledProduct, SharedProduct>,
+	instrument<pool_concrete_creator, latency_instrumentation>::creator
+>;
+
+using CountedAFactory = abstract_factory<
+	utils::tl<ISharedCountedProduct, ILocalCountedProduct>
+>;
+using CountedCFactory = concrete_factory<CountedAFactory, utils::tl<
+	CountedProduct<atomic_ref_count>, CountedProduct<local_ref_count>
+>>;
+
+using PrototypeAFactory = abstract_factory<
+	utils::tl<PrototypeProductA::abstract_t, PrototypeProductB::abstract_t>
+>;
+using PrototypeCFactory = concrete_factory<
+	PrototypeAFactory,
+	utils::tl<PrototypeProductA::abstract_t, PrototypeProductB::abstract_t>,
+	prototype_concrete_creator
+>;
+
+using RecyclingAFactory = abstract_factory<utils::tl<IRecycledProduct, IPooledProduct>>;
+using RecyclingCFactory = concrete_factory<
+	RecyclingAFactory, utils::tl<RecycledProduct, PooledProduct>, recycling_concrete_creator
+>;
+
+using InterningAFactory = abstract_factory<utils::tl<IInternedProduct>>;
+using InterningCFactory = concrete_factory<
+	InterningAFactory, utils::tl<InternedProduct>, interning_concrete_creator
+>;
+
+using ServiceAFactory = abstract_factory<utils::tl<IService<0>, IService<1>>>;
+using SingletonCFactory = concrete_factory<
+	ServiceAFactory, utils::tl<Service<0>, Service<1>>, singleton_concrete_creator
+>;
+using OrderedSingletonCFactory = singleton_concrete_factory<
+	ServiceAFactory, utils::tl<Service<0>, Service<1>>
+>;
+using ThreadLocalCFactory = concrete_factory<
+	ServiceAFactory, utils::tl<Service<0>, Service<1>>, thread_local_concrete_creator
+>;
+
+template<typename... Ts>
+using SingleRecyclingCreator = basic_recycling_concrete_creator<1, Ts...>;
+
+using SingleRecyclingCFactory = concrete_factory<
+	RecyclingAFactory, utils::tl<RecycledProduct, PooledProduct>, SingleRecyclingCreator
+>;
+
+using InstrumentedRecyclingCFactory = concrete_factory<
+	RecyclingAFactory,
+	utils::tl<RecycledProduct, PooledProduct>,
+	instrument<recycling_concrete_creator>::creator
+>;
+
+struct FinalProduct final : public IUniqueProduct
+{
+};
+
+using InstrumentedRawCFactory = concrete_factory<
+	abstract_factory<utils::tl<IRawProduct>>,
+	utils::tl<RawProduct>,
+	instrument<default_concrete_creator>::creator
+>;
+
+using InstrumentedPrototypeCFactory = concrete_factory<
+	PrototypeAFactory,
+	utils::tl<PrototypeProductA::abstract_t, PrototypeProductB::abstract_t>,
+	instrument<prototype_concrete_creator>::creator
+>;
+
+using InstrumentedSharedAFactory = abstract_factory<utils::tl<ISharedProduct, IUniqueProduct>>;
+using InstrumentedSharedCFactory = concrete_factory<
+	InstrumentedSharedAFactory,
+	utils::tl<SharedProduct, FinalProduct>,
+	instrument<default_concrete_creator>::creator
+>;
+
+using ForwardingAFactory = abstract_factory<
+	utils::tl<IForwardedProduct>, forwarding_abstract_creator
+>;
+using ForwardingCFactory = concrete_factory<
+	ForwardingAFactory, utils::tl<ForwardedProduct>
+>;
+
 int main()
 {
 	CFactory concreteFactory;
@@ -235,5 +695,736 @@ int main()
 	TYPE_ASSERT(existingProduct, std::shared_ptr<IExistingSharedProduct>);
 	assert(existingProduct);
 
+	// concrete factory resolves creator at compile time and calls it directly
+	auto directUnique = concreteFactory.create<IUniqueProduct>();
+	TYPE_ASSERT(directUnique, std::unique_ptr<IUniqueProduct>);
+	assert(directUnique);
+
+	auto directRaw = concreteFactory.create<IRawProduct>(false, 2);
+	TYPE_ASSERT(directRaw, IRawProduct*);
+	assert(directRaw);
+	delete directRaw;
+
+	// creators with private create() are called through abstract_factory
+	auto directValue = concreteFactory.create<IIntValue>(5);
+	TYPE_ASSERT(directValue, int);
+	assert(directValue == 5);
+
+	// product chosen at run time by its position in context_list
+	float valueById = 0;
+	const bool createdValue = abstractFactory->create_by_id(
+		AFactory::id_of<IIntValue>(), valueById, 4
+	);
+	assert(createdValue && valueById == 4.0f);
+
+	std::unique_ptr<IUniqueProduct> uniqueById;
+	const bool createdUnique = abstractFactory->create_by_id(
+		AFactory::id_of<IUniqueProduct>(), uniqueById
+	);
+	assert(createdUnique && uniqueById);
+
+	// unknown ids and products that can't be created as R are reported
+	std::unique_ptr<IUniqueProduct> failedById;
+	const bool createdShared = abstractFactory->create_by_id(
+		AFactory::id_of<ISharedProduct>(), failedById
+	);
+	const bool createdUnknown = abstractFactory->create_by_id(100, failedById);
+	assert(!createdShared && !createdUnknown && !failedById);
+
+	// products can be built in caller-supplied storage
+	CFactory::storage_t<IRawProduct> rawStorage;
+	assert(abstractFactory->storage_for<IRawProduct>().size == sizeof(RawProduct));
+
+	auto inplaceRaw = abstractFactory->create_at<IRawProduct>(
+		&rawStorage, sizeof(rawStorage), true, 3
+	);
+	TYPE_ASSERT(inplaceRaw, block_ptr<IRawProduct>);
+	assert(static_cast<void*>(inplaceRaw.get()) == &rawStorage);
+
+	// storage that is too small is rejected
+	assert(!abstractFactory->create_at<IRawProduct>(&rawStorage, 1, true, 3));
+
+	// reference count is kept inside the product, one allocation per product
+	CountedCFactory countedConcreteFactory;
+	CountedAFactory* countedAbstractFactory = &countedConcreteFactory;
+	{
+		const int allocationsBeforeCounted = heapAllocations;
+		auto counted = countedAbstractFactory->create<ISharedCountedProduct>(1);
+		TYPE_ASSERT(counted, intrusive_ptr<ISharedCountedProduct>);
+		assert(heapAllocations == allocationsBeforeCounted + 1);
+
+		auto countedCopy = counted;
+		assert(counted.use_count() == 2 && countedCopy->Value() == 1);
+
+		auto localCounted = countedAbstractFactory->create<ILocalCountedProduct>(2);
+		TYPE_ASSERT(localCounted, intrusive_ptr<ILocalCountedProduct>);
+		auto localCopy = localCounted;
+		localCounted.reset();
+		assert(localCopy.use_count() == 1 && localCopy->Value() == 2);
+		assert(countedDestructions == 0);
+	}
+	assert(countedDestructions == 2);
+
+	// products can be created on an executor, default_thread_pool() by default
+	auto asyncUnique = create_async<IUniqueProduct>(*abstractFactory);
+	TYPE_ASSERT(asyncUnique, std::future<std::unique_ptr<IUniqueProduct>>);
+	assert(asyncUnique.get());
+	assert(create_async<IUniqueProduct>(concreteFactory).get());
+
+	InlineExecutor inlineExecutor;
+	auto asyncValue = create_async<IIntValue>(*abstractFactory, inlineExecutor, 5);
+	TYPE_ASSERT(asyncValue, std::future<int>);
+	assert(asyncValue.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready);
+	assert(asyncValue.get() == 5);
+
+	CompactCFactory compactConcreteFactory;
+	CompactAFactory* compactAbstractFactory = &compactConcreteFactory;
+
+	auto compactAsyncValue = create_async<IFloatValue>(*compactAbstractFactory, 0.5f);
+	TYPE_ASSERT(compactAsyncValue, std::future<float>);
+	assert(compactAsyncValue.get() == 0.5f);
+
+	auto compactUnique = compactAbstractFactory->create<IUniqueProduct>();
+	TYPE_ASSERT(compactUnique, std::unique_ptr<IUniqueProduct>);
+	assert(compactUnique);
+
+	auto compactRaw = compactAbstractFactory->create<IRawProduct>(true, 1);
+	TYPE_ASSERT(compactRaw, IRawProduct*);
+	assert(compactRaw);
+	delete compactRaw;
+
+	auto compactValue = compactAbstractFactory->create<IFloatValue>(0.25f);
+	TYPE_ASSERT(compactValue, float);
+	assert(compactValue == 0.25f);
+
+	auto compactLazyValue = create_lazy<IFloatValue>(*compactAbstractFactory, 0.75f);
+	TYPE_ASSERT(compactLazyValue.get(), float&);
+	assert(!compactLazyValue.created() && compactLazyValue.get() == 0.75f);
+
+	SetPrototype(
+		compactConcreteFactory,
+		std::unique_ptr<PrototypeProductB>{ new PrototypeProductB() }
+	);
+	auto compactPrototype = compactAbstractFactory->create<PrototypeProductB::abstract_t>();
+	TYPE_ASSERT(compactPrototype, std::unique_ptr<PrototypeProductB::abstract_t>);
+	assert(compactPrototype);
+
+	auto compactExisting = compactAbstractFactory->create<IExistingFactoryProduct>();
+	TYPE_ASSERT(compactExisting, std::shared_ptr<IExistingSharedProduct>);
+	assert(compactExisting);
+
+	FlatCFactory flatConcreteFactory;
+	FlatAFactory* flatAbstractFactory = &flatConcreteFactory;
+
+	auto flatShared = flatAbstractFactory->create<ISharedProduct>();
+	TYPE_ASSERT(flatShared, std::shared_ptr<ISharedProduct>);
+	assert(flatShared);
+
+	auto flatValue = flatAbstractFactory->create<IIntValue>(3);
+	TYPE_ASSERT(flatValue, int);
+	assert(flatValue == 3);
+
+	SetPrototype(
+		flatConcreteFactory,
+		std::unique_ptr<PrototypeProductA>{ new PrototypeProductA() }
+	);
+	auto flatPrototype = flatAbstractFactory->create<PrototypeProductA::abstract_t>();
+	TYPE_ASSERT(flatPrototype, std::unique_ptr<PrototypeProductA::abstract_t>);
+	assert(flatPrototype);
+
+	auto flatDirect = flatConcreteFactory.create<IUniqueProduct>();
+	TYPE_ASSERT(flatDirect, std::unique_ptr<IUniqueProduct>);
+	assert(flatDirect);
+
+	PoolCFactory poolConcreteFactory;
+	PoolAFactory* poolAbstractFactory = &poolConcreteFactory;
+
+	auto pooled = poolAbstractFactory->create<IPooledProduct>(7);
+	TYPE_ASSERT(pooled, block_ptr<IPooledProduct>);
+	assert(pooled && pooled->Value() == 7);
+
+	// released block is reused by the next product
+	const void* pooledAddress = pooled.get();
+	pooled.reset();
+	pooled = poolAbstractFactory->create<IPooledProduct>(8);
+	assert(pooled.get() == pooledAddress && pooled->Value() == 8);
+
+	auto pooledShared = poolAbstractFactory->create<ISharedProduct>();
+	TYPE_ASSERT(pooledShared, std::shared_ptr<ISharedProduct>);
+	assert(pooledShared);
+
+	// pool has no released blocks, so batch takes adjacent fresh blocks
+	auto pooledBatch = poolAbstractFactory->create_n<IPooledProduct>(4, 9);
+	TYPE_ASSERT(pooledBatch, std::vector<block_ptr<IPooledProduct>>);
+	assert(pooledBatch.size() == 4);
+	for (const auto& product : pooledBatch)
+	{
+		TYPE_ASSERT(product, const block_ptr<IPooledProduct>&);
+		assert(product->Value() == 9);
+		assert(reinterpret_cast<const char*>(product.get())
+			- reinterpret_cast<const char*>(pooledBatch[0].get())
+			== (&product - &pooledBatch[0])
+				* static_cast<std::ptrdiff_t>(sizeof(PooledProduct)));
+	}
+
+	auto sharedBatch = poolConcreteFactory.create_n<ISharedProduct>(3);
+	TYPE_ASSERT(sharedBatch, std::vector<std::shared_ptr<ISharedProduct>>);
+	assert(sharedBatch.size() == 3 && sharedBatch[2]);
+
+	ForwardingCFactory forwardingConcreteFactory;
+	ForwardingAFactory* forwardingAbstractFactory = &forwardingConcreteFactory;
+
+	// arguments are moved from the caller into the product without copies,
+	// the only allocation is the product itself
+	std::string name(64, 'n');
+	std::vector<int> values(64, 1);
+	int allocationsBefore = heapAllocations;
+	auto forwarded = forwardingAbstractFactory->create<IForwardedProduct>(
+		std::move(name), std::move(values)
+	);
+	TYPE_ASSERT(forwarded, std::unique_ptr<IForwardedProduct>);
+	assert(forwarded && heapAllocations == allocationsBefore + 1);
+
+	// lvalues are copied exactly once
+	std::string otherName(64, 'o');
+	std::vector<int> otherValues(64, 2);
+	allocationsBefore = heapAllocations;
+	auto copied = forwardingAbstractFactory->create<IForwardedProduct>(
+		otherName, otherValues
+	);
+	TYPE_ASSERT(copied, std::unique_ptr<IForwardedProduct>);
+	assert(copied && heapAllocations == allocationsBefore + 3);
+
+	InplaceCFactory inplaceConcreteFactory;
+	InplaceAFactory* inplaceAbstractFactory = &inplaceConcreteFactory;
+
+	// small product lives inside the handle and moves along with it
+	auto inlineProduct = inplaceAbstractFactory->create<IInlineProduct>(6);
+	TYPE_ASSERT(inlineProduct, IInlineProduct::ret_type);
+	assert(inlineProduct.is_inline() && inlineProduct->Value() == 6);
+
+	auto movedProduct = std::move(inlineProduct);
+	assert(!inlineProduct && movedProduct.is_inline() && movedProduct->Value() == 6);
+
+	// bigger one falls back to the heap
+	auto oversized = inplaceAbstractFactory->create<IOversizedProduct>();
+	TYPE_ASSERT(oversized, IOversizedProduct::ret_type);
+	assert(oversized && !oversized.is_inline());
+
+	SharedCFactory sharedConcreteFactory;
+	SharedAFactory* sharedAbstractFactory = &sharedConcreteFactory;
+
+	// product and its control block share one allocation
+	auto counted = sharedAbstractFactory->create<ISharedProduct>();
+	TYPE_ASSERT(counted, std::shared_ptr<ISharedProduct>);
+	assert(counted && countedAllocations == 1);
+
+	// allocator is used only for shared_ptr products
+	auto uncounted = sharedAbstractFactory->create<IUniqueProduct>();
+	TYPE_ASSERT(uncounted, std::unique_ptr<IUniqueProduct>);
+	assert(uncounted && countedAllocations == 1);
+
+	CountingResource requestResource;
+	CountingResource otherResource;
+	ResourceCFactory resourceConcreteFactory{ &requestResource };
+	PoolAFactory* resourceAbstractFactory = &resourceConcreteFactory;
+
+	auto fromResource = resourceAbstractFactory->create<IPooledProduct>(3);
+	TYPE_ASSERT(fromResource, block_ptr<IPooledProduct>);
+	auto sharedFromResource = resourceAbstractFactory->create<ISharedProduct>();
+	TYPE_ASSERT(sharedFromResource, std::shared_ptr<ISharedProduct>);
+	assert(fromResource->Value() == 3 && sharedFromResource);
+	assert(requestResource.allocations == 2);
+
+	// rebinding doesn't affect already created products
+	resourceConcreteFactory.set_memory_resource(&otherResource);
+	auto fromOtherResource = resourceAbstractFactory->create<IPooledProduct>(4);
+	TYPE_ASSERT(fromOtherResource, block_ptr<IPooledProduct>);
+	assert(otherResource.allocations == 1);
+
+	fromResource.reset();
+	sharedFromResource.reset();
+	fromOtherResource.reset();
+	assert(requestResource.allocations == 0 && otherResource.allocations == 0);
+
+	CountingResource arenaUpstream;
+	ArenaCFactory arenaConcreteFactory{ 256, &arenaUpstream };
+	PoolAFactory* arenaAbstractFactory = &arenaConcreteFactory;
+
+	const void* firstArenaProduct = nullptr;
+	for (int request = 0; request != 3; ++request)
+	{
+		auto fromArena = arenaAbstractFactory->create<IPooledProduct>(request);
+		TYPE_ASSERT(fromArena, block_ptr<IPooledProduct>);
+		auto sharedFromArena = arenaAbstractFactory->create<ISharedProduct>();
+		TYPE_ASSERT(sharedFromArena, std::shared_ptr<ISharedProduct>);
+		assert(fromArena->Value() == request && sharedFromArena);
+
+		// every request starts from the beginning of the same chunk
+		if (!firstArenaProduct)
+		{
+			firstArenaProduct = fromArena.get();
+		}
+		assert(fromArena.get() == firstArenaProduct);
+
+		fromArena.reset();
+		sharedFromArena.reset();
+		arenaConcreteFactory.reset();
+	}
+	assert(arenaUpstream.allocations == 1);
+
+	block_ptr<IPooledProduct> outlivesFactory;
+	{
+		CachedPoolCFactory cachedConcreteFactory;
+		PoolAFactory* cachedAbstractFactory = &cachedConcreteFactory;
+
+		auto cached = cachedAbstractFactory->create<IPooledProduct>(1);
+		TYPE_ASSERT(cached, block_ptr<IPooledProduct>);
+		const void* firstCached = cached.get();
+		cached.reset();
+
+		// block released by this thread is reused first
+		cached = cachedAbstractFactory->create<IPooledProduct>(2);
+		assert(cached.get() == firstCached && cached->Value() == 2);
+
+		auto cachedShared = cachedAbstractFactory->create<ISharedProduct>();
+		TYPE_ASSERT(cachedShared, std::shared_ptr<ISharedProduct>);
+		auto cachedBatch = cachedAbstractFactory->create_n<IPooledProduct>(100, 3);
+		TYPE_ASSERT(cachedBatch, std::vector<block_ptr<IPooledProduct>>);
+		assert(cachedShared && cachedBatch.size() == 100 && cachedBatch.back()->Value() == 3);
+
+		// memory belongs to the thread caches, not to the factory
+		outlivesFactory = std::move(cached);
+	}
+	assert(outlivesFactory->Value() == 2);
+	outlivesFactory.reset();
+
+	CachedPoolCFactory teardownConcreteFactory;
+	PoolAFactory* teardownAbstractFactory = &teardownConcreteFactory;
+	std::thread{ [teardownAbstractFactory] {
+		// releases and creates products after the thread cache, which is
+		// created by the first create(), is destroyed
+		struct TeardownUser
+		{
+			PoolAFactory* factory;
+			block_ptr<IPooledProduct> product;
+
+			~TeardownUser()
+			{
+				product.reset();
+				auto late = factory->create<IPooledProduct>(6);
+				assert(late && late->Value() == 6);
+			}
+		};
+		thread_local TeardownUser user{ teardownAbstractFactory, {} };
+		user.product = teardownAbstractFactory->create<IPooledProduct>(5);
+		assert(user.product->Value() == 5);
+	} }.join();
+
+	PrototypeCFactory prototypeConcreteFactory;
+	PrototypeAFactory* prototypeAbstractFactory = &prototypeConcreteFactory;
+
+	// until prototype is set, create() returns empty product
+	auto unsetPrototype = prototypeAbstractFactory->create<PrototypeProductA::abstract_t>();
+	TYPE_ASSERT(unsetPrototype, std::unique_ptr<PrototypeProductA::abstract_t>);
+	assert(!unsetPrototype);
+
+	set_prototype(
+		prototypeConcreteFactory,
+		std::unique_ptr<PrototypeProductA>{ new PrototypeProductA() }
+	);
+	auto clonedA = prototypeAbstractFactory->create<PrototypeProductA::abstract_t>();
+	TYPE_ASSERT(clonedA, std::unique_ptr<PrototypeProductA::abstract_t>);
+	assert(clonedA);
+
+	// replaced prototype is used by following create() calls
+	set_prototype(
+		prototypeConcreteFactory,
+		std::unique_ptr<PrototypeProductA>{ new PrototypeProductA() }
+	);
+	assert(prototypeAbstractFactory->create<PrototypeProductA::abstract_t>());
+	assert(!prototypeAbstractFactory->create<PrototypeProductB::abstract_t>());
+
+	RecyclingCFactory recyclingConcreteFactory;
+	RecyclingAFactory* recyclingAbstractFactory = &recyclingConcreteFactory;
+
+	auto recycled = recyclingAbstractFactory->create<IRecycledProduct>(1);
+	TYPE_ASSERT(recycled, std::shared_ptr<IRecycledProduct>);
+	const void* firstRecycled = recycled.get();
+	recycled.reset();
+
+	// released product is reinitialized by reset() instead of constructor
+	recycled = recyclingAbstractFactory->create<IRecycledProduct>(2);
+	assert(recycled.get() == firstRecycled && recycled->Value() == 2);
+	assert(recycledConstructions == 1);
+
+	// products without reset() are constructed in released memory
+	auto reconstructed = recyclingAbstractFactory->create<IPooledProduct>(3);
+	TYPE_ASSERT(reconstructed, block_ptr<IPooledProduct>);
+	const void* firstReconstructed = reconstructed.get();
+	reconstructed.reset();
+	reconstructed = recyclingAbstractFactory->create<IPooledProduct>(4);
+	assert(reconstructed.get() == firstReconstructed && reconstructed->Value() == 4);
+
+	const recycling_stats recyclingStats = recycling_stats_of(
+		recyclingConcreteFactory, utils::type_identity<IRecycledProduct>{}
+	);
+	assert(recyclingStats.created == 2 && recyclingStats.recycled == 1);
+	assert(recyclingStats.discarded == 0 && recyclingStats.pooled == 0);
+	recycled.reset();
+	reconstructed.reset();
+
+	// products released when free list is full are destroyed
+	SingleRecyclingCFactory singleRecyclingConcreteFactory;
+	RecyclingAFactory* singleRecyclingAbstractFactory = &singleRecyclingConcreteFactory;
+	auto firstKept = singleRecyclingAbstractFactory->create<IRecycledProduct>(5);
+	auto secondKept = singleRecyclingAbstractFactory->create<IRecycledProduct>(6);
+	TYPE_ASSERT(secondKept, std::shared_ptr<IRecycledProduct>);
+	firstKept.reset();
+	secondKept.reset();
+	const recycling_stats boundedStats = recycling_stats_of(
+		singleRecyclingConcreteFactory, utils::type_identity<IRecycledProduct>{}
+	);
+	assert(boundedStats.discarded == 1 && boundedStats.pooled == 1);
+	assert(recycledConstructions == 3);
+
+	// products created from equal arguments are shared while alive
+	InterningCFactory interningConcreteFactory;
+	InterningAFactory* interningAbstractFactory = &interningConcreteFactory;
+	auto codec = interningAbstractFactory->create<IInternedProduct>("gzip", 6);
+	TYPE_ASSERT(codec, std::shared_ptr<const IInternedProduct>);
+	assert(interningAbstractFactory->create<IInternedProduct>("gzip", 6) == codec);
+	assert(interningAbstractFactory->create<IInternedProduct>("gzip", 9) != codec);
+	assert(interningAbstractFactory->create<IInternedProduct>("zstd", 6) != codec);
+	assert(internedConstructions == 3);
+
+	// threads asking for the same product get a single instance
+	{
+		std::vector<std::future<std::shared_ptr<const IInternedProduct>>> lookups;
+		for (int i = 0; i != 4; ++i)
+		{
+			lookups.push_back(std::async(std::launch::async, [=] {
+				return interningAbstractFactory->create<IInternedProduct>("lz4", 1);
+			}));
+		}
+		auto first = lookups.front().get();
+		for (std::size_t i = 1; i != lookups.size(); ++i)
+		{
+			assert(lookups[i].get() == first);
+		}
+		assert(first->Name() == "lz4");
+	}
+	assert(internedConstructions == 4);
+
+	// memory of released product is freed before its entry is evicted
+	{
+		auto released = interningAbstractFactory->create<IInternedProduct>("brotli", 4);
+		const int releasesBefore = heapReleases;
+		released.reset();
+		assert(heapReleases == releasesBefore + 1);
+	}
+	assert(internedConstructions == 5);
+
+	// released products are evicted, next request constructs a new one
+	assert(evict_released(
+		interningConcreteFactory, utils::type_identity<IInternedProduct>{}
+	) == 4);
+	const interning_stats interningStats = interning_stats_of(
+		interningConcreteFactory, utils::type_identity<IInternedProduct>{}
+	);
+	assert(interningStats.created == 9 && interningStats.shared == 4);
+	assert(interningStats.evicted == 4 && interningStats.entries == 1);
+	assert(interningAbstractFactory->create<IInternedProduct>("gzip", 6) == codec);
+	assert(interningAbstractFactory->create<IInternedProduct>("lz4", 1)->Name() == "lz4");
+	assert(internedConstructions == 6);
+
+	// prewarmed pool serves first requests without allocations
+	PoolCFactory prewarmedConcreteFactory;
+	prewarmedConcreteFactory.prewarm<IPooledProduct>(4);
+	PoolAFactory* prewarmedAbstractFactory = &prewarmedConcreteFactory;
+	const int allocationsBeforeRequests = heapAllocations;
+	{
+		block_ptr<IPooledProduct> prewarmed[4];
+		for (int i = 0; i != 4; ++i)
+		{
+			prewarmed[i] = prewarmedAbstractFactory->create<IPooledProduct>(i);
+		}
+		assert(prewarmed[3]->Value() == 3);
+	}
+	assert(heapAllocations == allocationsBeforeRequests);
+
+	// recycling creators construct products ahead of time, products that
+	// can't be constructed without arguments are skipped by prewarm_all()
+	RecyclingCFactory prewarmedRecyclingFactory;
+	prewarmedRecyclingFactory.prewarm<IRecycledProduct>(2, 7);
+	prewarmedRecyclingFactory.prewarm_all(2);
+	assert(recycledConstructions == 5);
+	assert(recycling_stats_of(
+		prewarmedRecyclingFactory, utils::type_identity<IRecycledProduct>{}
+	).pooled == 2);
+	assert(recycling_stats_of(
+		prewarmedRecyclingFactory, utils::type_identity<IPooledProduct>{}
+	).pooled == 2);
+	assert(prewarmedRecyclingFactory.create<IRecycledProduct>(8)->Value() == 8);
+	assert(recycledConstructions == 5);
+
+	CachedPoolCFactory prewarmedCachedFactory;
+	prewarm_all_async(prewarmedCachedFactory, 64).get();
+
+	// executor can be passed as a temporary
+	std::future<void> prewarmedInline = prewarm_all_async(
+		prewarmedCachedFactory, InlineExecutor{}, 64
+	);
+	assert(prewarmedInline.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready);
+
+	// singleton is created once, arguments of later calls are ignored
+	std::shared_ptr<IService<1>> outlivesSingleton;
+	{
+		SingletonCFactory singletonConcreteFactory;
+		ServiceAFactory* singletonAbstractFactory = &singletonConcreteFactory;
+		auto config = singletonAbstractFactory->create<IService<1>>(1);
+		TYPE_ASSERT(config, std::shared_ptr<IService<1>>);
+		auto log = singletonAbstractFactory->create<IService<0>>(2);
+		TYPE_ASSERT(log, IService<0>*);
+		assert(singletonAbstractFactory->create<IService<0>>(3) == log);
+		assert(log->Value() == 2);
+
+		// returned shared_ptr shares ownership with the creator
+		assert(singletonAbstractFactory->create<IService<1>>(4) == config);
+		assert(config->Value() == 1 && config.use_count() == 2);
+		std::weak_ptr<IService<1>> weakConfig = config;
+		config.reset();
+		assert(!weakConfig.expired());
+		config = weakConfig.lock();
+
+		// threads get the product created by the first of them
+		std::vector<std::future<IService<0>*>> lookups;
+		for (int i = 0; i != 4; ++i)
+		{
+			lookups.push_back(std::async(std::launch::async, [=] {
+				return singletonAbstractFactory->create<IService<0>>(i);
+			}));
+		}
+		for (auto& lookup : lookups)
+		{
+			assert(lookup.get() == log);
+		}
+		outlivesSingleton = config;
+	}
+	// products are released with their creators, in order of context_list,
+	// shared product is destroyed when its last user is gone
+	assert(serviceDestructions == std::vector<int>({ 0 }));
+	assert(outlivesSingleton->Value() == 1);
+	outlivesSingleton.reset();
+	assert(serviceDestructions == std::vector<int>({ 0, 1 }));
+	serviceDestructions.clear();
+
+	{
+		OrderedSingletonCFactory orderedConcreteFactory;
+		ServiceAFactory* orderedAbstractFactory = &orderedConcreteFactory;
+		orderedAbstractFactory->create<IService<0>>(1);
+		orderedAbstractFactory->create<IService<1>>(2);
+	}
+	// singleton_concrete_factory destroys them in reverse order of creation
+	assert(serviceDestructions == std::vector<int>({ 1, 0 }));
+	serviceDestructions.clear();
+
+	// every thread gets own product, destroyed when the thread exits
+	{
+		ThreadLocalCFactory threadLocalConcreteFactory;
+		ServiceAFactory* threadLocalAbstractFactory = &threadLocalConcreteFactory;
+		IService<0>* mainService = threadLocalAbstractFactory->create<IService<0>>(5);
+		assert(threadLocalAbstractFactory->create<IService<0>>(6) == mainService);
+
+		int otherValue = 0;
+		std::thread{ [&] {
+			IService<0>* otherService = threadLocalAbstractFactory->create<IService<0>>(7);
+			threadLocalAbstractFactory->create<IService<1>>(8);
+			assert(threadLocalAbstractFactory->create<IService<0>>(9) == otherService);
+			assert(otherService != mainService);
+			otherValue = otherService->Value();
+		} }.join();
+		assert(otherValue == 7 && mainService->Value() == 5);
+		assert(serviceDestructions == std::vector<int>({ 1, 0 }));
+
+		// other factory of the same type has own products
+		ThreadLocalCFactory otherThreadLocalFactory;
+		ServiceAFactory* otherThreadLocalAbstractFactory = &otherThreadLocalFactory;
+		IService<0>* otherFactoryService =
+			otherThreadLocalAbstractFactory->create<IService<0>>(10);
+		assert(otherFactoryService != mainService && otherFactoryService->Value() == 10);
+		assert(threadLocalAbstractFactory->create<IService<0>>(11) == mainService);
+	}
+	// destroyed factories erase products of threads that are still running
+	assert(serviceDestructions == std::vector<int>({ 1, 0, 0, 0 }));
+	serviceDestructions.clear();
+
+	// so factories created by a long-running thread don't pile them up
+	for (int i = 0; i != 100; ++i)
+	{
+		ThreadLocalCFactory transientFactory;
+		assert(transientFactory.create<IService<0>>(i)->Value() == i);
+		assert(serviceDestructions.size() == static_cast<std::size_t>(i));
+	}
+	assert(serviceDestructions.size() == 100);
+	serviceDestructions.clear();
+
+	// including products of other threads
+	{
+		std::promise<void> serviceCreated;
+		std::promise<void> factoryGone;
+		std::thread worker;
+		{
+			ThreadLocalCFactory transientFactory;
+			ServiceAFactory* transientAbstractFactory = &transientFactory;
+			worker = std::thread{ [&] {
+				transientAbstractFactory->create<IService<0>>(1);
+				serviceCreated.set_value();
+				factoryGone.get_future().wait();
+			} };
+			serviceCreated.get_future().wait();
+			transientAbstractFactory->create<IService<0>>(2);
+		}
+		assert(serviceDestructions.size() == 2);
+		factoryGone.set_value();
+		worker.join();
+		assert(serviceDestructions.size() == 2);
+	}
+	serviceDestructions.clear();
+
+	// lazy handle stores arguments and creates product on first access
+	RecyclingCFactory lazyConcreteFactory;
+	RecyclingAFactory* lazyAbstractFactory = &lazyConcreteFactory;
+	const int allocationsBeforeLazy = heapAllocations;
+	auto lazyRecycled = create_lazy<IRecycledProduct>(*lazyAbstractFactory, 9);
+	assert(heapAllocations == allocationsBeforeLazy);
+	assert(!lazyRecycled.created() && recycledConstructions == 5);
+	assert(lazyRecycled->Value() == 9 && lazyRecycled.created());
+	assert(recycledConstructions == 6);
+	TYPE_ASSERT(lazyRecycled.get(), std::shared_ptr<IRecycledProduct>&);
+
+	// product created before move is moved to the new handle
+	auto movedLazy = std::move(lazyRecycled);
+	assert(movedLazy.created() && (*movedLazy).Value() == 9);
+	assert(recycledConstructions == 6);
+
+	// threads accessing the same handle share a single product
+	{
+		auto lazyUnique = create_lazy<IUniqueProduct>(*abstractFactory);
+		TYPE_ASSERT(lazyUnique.get(), std::unique_ptr<IUniqueProduct>&);
+		std::vector<std::future<IUniqueProduct*>> accesses;
+		for (int i = 0; i != 4; ++i)
+		{
+			accesses.push_back(std::async(std::launch::async, [&lazyUnique] {
+				return lazyUnique.get().get();
+			}));
+		}
+		IUniqueProduct* first = accesses.front().get();
+		for (std::size_t i = 1; i != accesses.size(); ++i)
+		{
+			assert(accesses[i].get() == first);
+		}
+		assert(first && lazyUnique.get().get() == first);
+	}
+
+	InstrumentedCFactory instrumentedConcreteFactory;
+	PoolAFactory* instrumentedAbstractFactory = &instrumentedConcreteFactory;
+
+	auto instrumented = instrumentedAbstractFactory->create<IPooledProduct>(5);
+	TYPE_ASSERT(instrumented, block_ptr<IPooledProduct>);
+	auto instrumentedBatch = instrumentedAbstractFactory->create_n<IPooledProduct>(2, 6);
+	TYPE_ASSERT(instrumentedBatch, std::vector<block_ptr<IPooledProduct>>);
+	assert(instrumented->Value() == 5 && instrumentedBatch.size() == 2);
+	instrumentedBatch.clear();
+
+	std::uint64_t instrumentedLive[2] = {};
+	std::uint64_t pooledLatencyBound = 0;
+	dump_product_stats(instrumentedConcreteFactory, [&](std::size_t id,
+		const product_stats_snapshot& stats) {
+		instrumentedLive[id] = stats.live();
+		if (id == PoolAFactory::id_of<IPooledProduct>())
+		{
+			// create_n() constructs products without create()
+			assert(stats.created == 3 && stats.destroyed == 2);
+			assert(stats.object_bytes >= 3 * sizeof(PooledProduct));
+			pooledLatencyBound = stats.latency_quantile(1.0);
+		}
+	});
+	assert(instrumentedLive[0] == 1 && instrumentedLive[1] == 0);
+	assert(pooledLatencyBound != 0);
+
+	// statistics belong to the factory, products may outlive it
+	std::shared_ptr<ISharedProduct> outlivesStats;
+	{
+		InstrumentedSharedCFactory statsConcreteFactory;
+		outlivesStats = statsConcreteFactory.create<ISharedProduct>();
+		assert(typeid(*outlivesStats.get()) == typeid(SharedProduct));
+		statsConcreteFactory.create<ISharedProduct>().reset();
+		statsConcreteFactory.create<IUniqueProduct>().reset();
+		std::uint64_t statsLive[2] = {};
+		dump_product_stats(statsConcreteFactory, [&](std::size_t id,
+			const product_stats_snapshot& stats) {
+			statsLive[id] = stats.live();
+		});
+		// shared_ptr deleter is hooked, unique_ptr with default deleter
+		// isn't, so destruction of its products isn't seen
+		assert(statsLive[0] == 1 && statsLive[1] == 1);
+	}
+	outlivesStats.reset();
+
+	// in-place products are hooked even if ret_type isn't
+	{
+		InstrumentedRawCFactory instrumentedRawFactory;
+		InstrumentedRawCFactory::storage_t<IRawProduct> instrumentedStorage;
+		auto instrumentedInPlace = instrumentedRawFactory.create_at<IRawProduct>(
+			&instrumentedStorage, sizeof(instrumentedStorage), true, 7
+		);
+		assert(static_cast<void*>(instrumentedInPlace.get()) == &instrumentedStorage);
+		instrumentedInPlace.reset();
+		const product_stats_snapshot rawStats = product_stats_of(
+			instrumentedRawFactory, utils::type_identity<IRawProduct>{}
+		);
+		assert(rawStats.created == 1 && rawStats.live() == 0);
+	}
+
+	// products of custom creators keep their type and constructor
+	{
+		InstrumentedPrototypeCFactory instrumentedPrototypeFactory;
+		set_prototype(
+			wrapped_creator(instrumentedPrototypeFactory,
+				utils::type_identity<PrototypeProductA::abstract_t>{}),
+			std::unique_ptr<PrototypeProductA>{ new PrototypeProductA() }
+		);
+		auto instrumentedClone = instrumentedPrototypeFactory.create<
+			PrototypeProductA::abstract_t
+		>();
+		assert(typeid(*instrumentedClone.get()) == typeid(PrototypeProductA));
+		// unset prototype returns empty product, it isn't counted
+		assert(!instrumentedPrototypeFactory.create<PrototypeProductB::abstract_t>());
+		assert(product_stats_of(instrumentedPrototypeFactory,
+			utils::type_identity<PrototypeProductA::abstract_t>{}).created == 1);
+		assert(product_stats_of(instrumentedPrototypeFactory,
+			utils::type_identity<PrototypeProductB::abstract_t>{}).created == 0);
+	}
+
+	// creator-specific functions are called on the wrapped creator
+	InstrumentedRecyclingCFactory instrumentedRecyclingFactory;
+	instrumentedRecyclingFactory.prewarm<IRecycledProduct>(2, 0);
+	auto instrumentedRecycled = instrumentedRecyclingFactory.create<IRecycledProduct>(4);
+	TYPE_ASSERT(instrumentedRecycled, std::shared_ptr<IRecycledProduct>);
+	assert(instrumentedRecycled->Value() == 4);
+	assert(recycling_stats_of(
+		wrapped_creator(instrumentedRecyclingFactory, utils::type_identity<IRecycledProduct>{}),
+		utils::type_identity<IRecycledProduct>{}
+	).recycled == 1);
+	// prewarmed products aren't counted until create() returns them
+	assert(product_stats_of(
+		instrumentedRecyclingFactory, utils::type_identity<IRecycledProduct>{}
+	).created == 1);
+	instrumentedRecycled.reset();
+	assert(product_stats_of(
+		instrumentedRecyclingFactory, utils::type_identity<IRecycledProduct>{}
+	).live() == 0);
+
 	return 0;
 }
\ No newline at end of file
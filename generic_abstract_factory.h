@@ -4,6 +4,23 @@
 #include <type_traits>
 #include <memory>
 #include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// memory_resource and polymorphic_allocator are own C++11 classes unless
+// GENERIC_ABSTRACT_FACTORY_STD_PMR is defined, then they're std::pmr ones.
+// The choice changes types of the library, so it has to be the same for
+// every translation unit of a program regardless of its -std
+#ifdef GENERIC_ABSTRACT_FACTORY_STD_PMR
+#include <memory_resource>
+#endif
 
 namespace generic_abstract_factory
 {
@@ -95,6 +112,21 @@ namespace generic_abstract_factory
 		template<typename T, typename Default>
 		using get_ret_type_t = typename get_ret_type<T, Default>::type;
 
+		template<typename T, typename = utils::void_t<>>
+		struct get_creation_features
+		{
+			using type = utils::tl<>;
+		};
+
+		template<typename T>
+		struct get_creation_features<T, utils::void_t<typename T::creation_features>>
+		{
+			using type = typename T::creation_features;
+		};
+
+		template<typename T>
+		using get_creation_features_t = typename get_creation_features<T>::type;
+
 		template<template<typename...>class, typename...>
 		struct generate_creators;
 
@@ -139,140 +171,3941 @@ namespace generic_abstract_factory
 			using type = Creator<Context, Concrete, Root>;
 		};
 
+		template<typename Context>
+		struct context_abstract;
+
+		template<typename Abstract, typename... Ts>
+		struct context_abstract<utils::tl<Abstract, Ts...>>
+		{
+			using type = Abstract;
+		};
+
+		template<typename Context>
+		struct context_ret;
+
+		template<typename Abstract, typename Ret, typename... Ts>
+		struct context_ret<utils::tl<Abstract, Ret, Ts...>>
+		{
+			using type = Ret;
+		};
+
+		// finds creator for Abstract in the chain built by generate_creators,
+		// void if there's no such product
+		template<typename Abstract, template<typename...>class, typename...>
+		struct find_creator
+		{
+			using type = void;
+		};
+
+		template<
+			typename Abstract,
+			template<typename...>class Creator,
+			typename Root,
+			typename Context,
+			typename... Contexts,
+			typename Concrete,
+			typename... Concretes
+		>
+		struct find_creator<
+			Abstract,
+			Creator,
+			Root,
+			utils::tl<Context, Contexts...>,
+			utils::tl<Concrete, Concretes...>
+		>
+			: public std::conditional<
+				std::is_same<
+					typename context_abstract<Context>::type, Abstract
+				>::value,
+				generate_creators<
+					Creator,
+					Root,
+					utils::tl<Context, Contexts...>,
+					utils::tl<Concrete, Concretes...>
+				>,
+				find_creator<
+					Abstract,
+					Creator,
+					Root,
+					utils::tl<Contexts...>,
+					utils::tl<Concretes...>
+				>
+			>::type
+		{
+		};
+
+		// creator's own create() called without virtual dispatch, available
+		// only if it's accessible
+		template<typename Creator, typename Abstract, typename... Args>
+		auto static_create(Creator& creator, Args&& ... args)
+			-> decltype(creator.Creator::create(
+				utils::type_identity<Abstract>{}, std::forward<Args>(args)...))
+		{
+			return creator.Creator::create(
+				utils::type_identity<Abstract>{}, std::forward<Args>(args)...
+			);
+		}
+
+		template<typename Void, typename...>
+		struct is_static_creatable_impl : public std::false_type
+		{
+		};
+
+		template<typename Creator, typename Abstract, typename... Args>
+		struct is_static_creatable_impl<
+			void_t<decltype(static_create<Creator, Abstract>(
+				std::declval<Creator&>(), std::declval<Args>()...))>,
+			Creator, Abstract, Args...
+		>
+			: public std::true_type
+		{
+		};
+
+		template<typename Creator, typename Abstract, typename... Args>
+		struct is_static_creatable
+			: public is_static_creatable_impl<void, Creator, Abstract, Args...>
+		{
+		};
+
+		template<typename T, typename List>
+		struct index_of
+		{
+			static_assert(!std::is_same<T, T>::value, "Type is not in the list");
+		};
+
+		template<typename T, typename... Ts>
+		struct index_of<T, tl<T, Ts...>>
+			: public std::integral_constant<std::size_t, 0>
+		{
+		};
+
+		template<typename T, typename U, typename... Ts>
+		struct index_of<T, tl<U, Ts...>>
+			: public std::integral_constant<std::size_t,
+				1 + index_of<T, tl<Ts...>>::value>
+		{
+		};
+
+		template<typename T, typename List>
+		struct contains : public std::false_type
+		{
+		};
+
+		template<typename T, typename... Ts>
+		struct contains<T, tl<T, Ts...>> : public std::true_type
+		{
+		};
+
+		template<typename T, typename U, typename... Ts>
+		struct contains<T, tl<U, Ts...>> : public contains<T, tl<Ts...>>
+		{
+		};
+
+		// whether Creator can create Abstract from Args as R
+		template<typename Void, typename...>
+		struct is_creatable_as_impl : public std::false_type
+		{
+		};
+
+		template<typename R, typename Creator, typename Abstract, typename... Args>
+		struct is_creatable_as_impl<
+			void_t<decltype(std::declval<Creator&>().create(
+				type_identity<Abstract>{}, std::declval<Args>()...))>,
+			R, Creator, Abstract, Args...
+		>
+			: public std::is_convertible<decltype(std::declval<Creator&>().create(
+				type_identity<Abstract>{}, std::declval<Args>()...)), R>
+		{
+		};
+
+		template<typename R, typename Creator, typename Abstract, typename... Args>
+		struct is_creatable_as
+			: public is_creatable_as_impl<void, R, Creator, Abstract, Args...>
+		{
+		};
+
 		struct convertible_to_any
 		{
 			template<typename T>
 			operator T();
 		};
-	} //namespace utils
 
-	template<typename...> class abstract_creator_interface;
+		template<typename Ptr>
+		using pointer_element_t = typename std::pointer_traits<Ptr>::element_type;
 
-	template<typename Abstract, typename Ret, typename... Args>
-	class abstract_creator_interface<Abstract, Ret, utils::tl<Args...>>
-	{
-	public:
-		using context = utils::tl<Abstract, Ret, utils::tl<Args...>>;
+		template<typename T>
+		struct is_shared_ptr : public std::false_type
+		{
+		};
 
-		virtual Ret create(utils::type_identity<Abstract>, Args...) = 0;
-		virtual ~abstract_creator_interface() = default;
-	};
+		template<typename T>
+		struct is_shared_ptr<std::shared_ptr<T>> : public std::true_type
+		{
+		};
 
-	template<typename Abstract>
-	using default_abstract_creator = abstract_creator_interface<
-		Abstract,
-		utils::get_ret_type_t<
-			Abstract, utils::type_identity<std::unique_ptr<Abstract>>
-		>,
-		utils::get_ctor_args_t<Abstract>
-	>;
+		// constructs Concrete in a raw block, release(block) is called if
+		// constructor throws
+		template<typename Concrete, typename Release, typename... Args>
+		Concrete* construct_at(void* block, Release release, Args&&... args)
+		{
+			try
+			{
+				return ::new(block) Concrete(std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				release(block);
+				throw;
+			}
+		}
 
-	template<typename...> class default_concrete_creator;
+		// by-value parameter of forwarding creators: refers to rvalue passed
+		// by the caller and owns a copy of anything else, so that product
+		// can always move from it. Copy of forwarded_arg owns a copy of
+		// the value
+		template<typename T>
+		class forwarded_arg
+		{
+			template<typename U>
+			using is_source = std::integral_constant<bool,
+				!std::is_same<typename std::decay<U>::type, forwarded_arg>::value
+				&& std::is_constructible<T, U&&>::value>;
 
-	template<
-		typename Abstract,
-		typename Concrete,
-		typename Base,
-		typename Ret,
-		typename... Args
-	>
-	class default_concrete_creator<
-		utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
-	>
-		: public Base
-	{
-		static_assert(std::is_constructible<Concrete, Args...>::value,
-			"Product is not constructible from a given set of arguments");
-		static_assert(std::is_constructible<Ret, Concrete*>::value,
-			"ret_type is not constructible from Concrete*");
-#ifdef __clang__
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Woverloaded-virtual"
-#endif
-		Ret create(utils::type_identity<Abstract>, Args... args) override
+		public:
+			forwarded_arg(T&& value) noexcept
+				: pointer{ &value }
+			{
+			}
+
+			template<typename U,
+				typename = typename std::enable_if<is_source<U>::value>::type
+			>
+			forwarded_arg(U&& value)
+				: pointer{ ::new(&storage) T(std::forward<U>(value)) }, owner{ true }
+			{
+			}
+
+			forwarded_arg(const forwarded_arg& other)
+				: pointer{ ::new(&storage) T(*other.pointer) }, owner{ true }
+			{
+			}
+
+			forwarded_arg(forwarded_arg&& other)
+				: pointer{ other.owner
+					? ::new(&storage) T(std::move(*other.pointer))
+					: other.pointer
+				},
+				owner{ other.owner }
+			{
+			}
+
+			forwarded_arg& operator=(const forwarded_arg&) = delete;
+
+			~forwarded_arg()
+			{
+				if (owner)
+				{
+					pointer->~T();
+				}
+			}
+
+			operator T&&() const noexcept
+			{
+				return std::move(*pointer);
+			}
+
+		private:
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+			T* pointer;
+			bool owner{};
+		};
+
+		// class type arguments are passed as forwarded_arg
+		template<typename Arg>
+		using forwarded_arg_t = typename std::conditional<
+			std::is_class<Arg>::value,
+			forwarded_arg<typename std::remove_cv<Arg>::type>,
+			Arg
+		>::type;
+
+		template<typename Args>
+		struct forwarded_args;
+
+		template<typename... Args>
+		struct forwarded_args<tl<Args...>>
 		{
-			return Ret{ new Concrete(std::forward<Args>(args)...) };
-		}
-#ifdef __clang__
-#pragma clang diagnostic pop
-#endif
-	};
+			using type = tl<forwarded_arg_t<Args>...>;
+		};
 
-	template<
-		typename AbstractList,
-		template<typename...>class Creator = default_abstract_creator
-	>
-	class abstract_factory;
+		template<typename Args>
+		using forwarded_args_t = typename forwarded_args<Args>::type;
 
-	template<typename... AbstractList, template<typename...>class Creator>
-	class abstract_factory<utils::tl<AbstractList...>, Creator>
-		: protected Creator<AbstractList>...
-	{
-	public:
-		using context_list = utils::tl<typename Creator<AbstractList>::context...>;
+		template<bool...> struct bool_pack;
 
-		template<typename Abstract, typename... Args,
-			typename = typename std::enable_if<std::is_base_of<
-				Creator<Abstract>,
-				abstract_factory
-			>::value>::type
+		template<bool... Bs>
+		using all_of = std::is_same<bool_pack<true, Bs...>, bool_pack<Bs..., true>>;
+
+		// argument of type Arg that can be passed to several creations in a
+		// row: lvalue references are passed as is, everything else is copied
+		template<typename Arg>
+		using reusable_arg_t = typename std::conditional<
+			std::is_lvalue_reference<Arg>::value,
+			Arg,
+			typename std::remove_cv<typename std::remove_reference<Arg>::type>::type
+		>::type;
+
+		template<typename Arg>
+		struct is_reusable_arg : public std::integral_constant<bool,
+			std::is_lvalue_reference<Arg>::value
+			|| std::is_copy_constructible<reusable_arg_t<Arg>>::value>
+		{
+		};
+
+		template<typename T>
+		struct is_reusable_arg<forwarded_arg<T>>
+			: public std::is_copy_constructible<T>
+		{
+		};
+
+		template<typename... Args>
+		using are_reusable_args = all_of<is_reusable_arg<Args>::value...>;
+
+		template<typename Context>
+		struct is_batch_creatable;
+
+		template<typename Abstract, typename Ret, typename... Args>
+		struct is_batch_creatable<tl<Abstract, Ret, tl<Args...>>>
+			: public are_reusable_args<Args...>
+		{
+		};
+
+		// constructs count products in adjacent blocks, block i is at
+		// first + i * stride, every product is passed to collect(). Args
+		// declared as Params are copied for each product, if constructor
+		// throws release(block) is called for all blocks left unused
+		template<
+			typename Concrete,
+			typename... Params,
+			typename Release,
+			typename Collect,
+			typename... Ts
 		>
-		auto create(Args&& ...args) ->
-			decltype(Creator<Abstract>::create(
-				utils::type_identity<Abstract>{}, std::forward<Args>(args)...)
-			)
+		void construct_n(unsigned char* first, std::size_t stride, std::size_t count,
+			Release release, Collect collect, Ts&... args)
 		{
-			Creator<Abstract>* creator = this;
+			std::size_t constructed = 0;
+			try
+			{
+				for (; constructed != count; ++constructed)
+				{
+					collect(::new(first + constructed * stride) Concrete(
+						static_cast<reusable_arg_t<Params>>(args)...
+					));
+				}
+			}
+			catch (...)
+			{
+				for (std::size_t i = constructed; i != count; ++i)
+				{
+					release(first + i * stride);
+				}
+				throw;
+			}
+		}
 
-			return creator->create(
-				utils::type_identity<Abstract>{}, std::forward<Args>(args)...
-			);
+		// batch creation by make() that creates a single product from Args
+		// declared as Params, does nothing when they can't be reused
+		template<
+			typename Ret,
+			typename... Params,
+			typename Make,
+			typename... Ts
+		>
+		std::vector<Ret> create_n(std::true_type, std::size_t count,
+			Make make, Ts&... args)
+		{
+			std::vector<Ret> products;
+			products.reserve(count);
+			for (std::size_t i = 0; i != count; ++i)
+			{
+				products.push_back(make(static_cast<reusable_arg_t<Params>>(args)...));
+			}
+			return products;
 		}
 
-		template<typename Abstract, typename... Args, 
-			typename = typename std::enable_if<!std::is_base_of<
-				Creator<Abstract>,
-				abstract_factory
-			>::value  
-			|| !utils::is_invocable_memfn<
-				decltype(&Creator<Abstract>::create),
-				utils::type_identity<Abstract>,
-				Args...
-			>::value>::type>
-		utils::convertible_to_any create(Args && ...)
-		{
-			static_assert(std::is_base_of<
-					Creator<Abstract>,
-					abstract_factory
-				>::value,
-				"abstract_factory::create(): wrong product type"
-			);
-			
-			static_assert(utils::is_invocable_memfn<
-					decltype(&Creator<Abstract>::create),
-					utils::type_identity<Abstract>,
-					Args...
-				>::value,
-				"abstract_factory::create(): wrong arguments"
-			);
-			
+		template<
+			typename Ret,
+			typename... Params,
+			typename Make,
+			typename... Ts
+		>
+		std::vector<Ret> create_n(std::false_type, std::size_t, Make, Ts&...)
+		{
 			return {};
 		}
-	};
 
-	template<
-		typename AbstractFactory,
-		typename ConcreteList,
-		template<typename...>class Creator = default_concrete_creator
-	>
-	class concrete_factory
-		: public utils::generate_creators<
-			Creator,
-			AbstractFactory,
-			typename AbstractFactory::context_list,
-			ConcreteList
-		>::type
-	{
+		// builds product of type Concrete and wraps it into Ret, specialize it
+		// to teach concrete creators about new ret_type kinds
+		template<typename Ret, typename Enabled = void>
+		struct product_builder
+		{
+			template<typename Concrete>
+			using is_buildable = std::is_constructible<Ret, Concrete*>;
+
+			template<typename Concrete, typename Allocator, typename... Args>
+			static Ret create(const Allocator&, Args&&... args)
+			{
+				return Ret{ new Concrete(std::forward<Args>(args)...) };
+			}
+		};
+
+		// single allocation for product and its control block
+		template<typename T>
+		struct product_builder<std::shared_ptr<T>>
+		{
+			template<typename Concrete>
+			using is_buildable = std::is_convertible<Concrete*, T*>;
+
+			template<typename Concrete, typename Allocator, typename... Args>
+			static std::shared_ptr<T> create(const Allocator& allocator, Args&&... args)
+			{
+				using concrete_allocator = typename std::allocator_traits<
+					Allocator
+				>::template rebind_alloc<Concrete>;
+
+				return std::allocate_shared<Concrete>(
+					concrete_allocator(allocator), std::forward<Args>(args)...
+				);
+			}
+		};
+
+		// writes to every page of memory that isn't used yet, so that page
+		// faults happen now rather than on first use
+		inline void touch_pages(void* memory, std::size_t size) noexcept
+		{
+			constexpr std::size_t page_size = 4096;
+			volatile unsigned char* bytes = static_cast<unsigned char*>(memory);
+			for (std::size_t offset = 0; offset < size; offset += page_size)
+			{
+				bytes[offset] = 0;
+			}
+		}
+
+		// fixed-size block allocator, memory is returned to the system only
+		// when the pool itself is destroyed
+		class slab_pool
+		{
+		public:
+			slab_pool(std::size_t size, std::size_t align,
+				std::size_t blocksPerSlab = 64)
+				: blockAlign{ align < alignof(node) ? alignof(node) : align },
+				blockSize{ round_up(size < sizeof(node) ? sizeof(node) : size, blockAlign) },
+				slabHeader{ round_up(sizeof(void*), blockAlign) },
+				blocksPerSlab{ blocksPerSlab ? blocksPerSlab : 1 }
+			{
+			}
+
+			slab_pool(const slab_pool&) = delete;
+			slab_pool& operator=(const slab_pool&) = delete;
+
+			~slab_pool()
+			{
+				while (slabs)
+				{
+					void* next = *static_cast<void**>(slabs);
+					::operator delete(slabs);
+					slabs = next;
+				}
+			}
+
+			void* allocate()
+			{
+				if (freeList)
+				{
+					node* block = freeList;
+					freeList = block->next;
+					return block;
+				}
+
+				if (fresh == freshEnd)
+				{
+					add_slab(blocksPerSlab);
+				}
+
+				void* block = fresh;
+				fresh += blockSize;
+				return block;
+			}
+
+			void deallocate(void* block) noexcept
+			{
+				node* released = static_cast<node*>(block);
+				released->next = freeList;
+				freeList = released;
+			}
+
+			// count adjacent never used blocks, block_size() apart, each of
+			// them is released separately by deallocate()
+			void* allocate_contiguous(std::size_t count)
+			{
+				if (static_cast<std::size_t>(freshEnd - fresh) < blockSize * count)
+				{
+					// the rest of current slab is still reachable by allocate()
+					for (; fresh != freshEnd; fresh += blockSize)
+					{
+						deallocate(fresh);
+					}
+					add_slab(count > blocksPerSlab ? count : blocksPerSlab);
+				}
+
+				void* first = fresh;
+				fresh += blockSize * count;
+				return first;
+			}
+
+			// count more blocks that allocate() hands out without touching
+			// new memory
+			void reserve(std::size_t count)
+			{
+				unsigned char* first = static_cast<unsigned char*>(
+					allocate_contiguous(count));
+				touch_pages(first, blockSize * count);
+				while (count)
+				{
+					deallocate(first + blockSize * --count);
+				}
+			}
+
+			bool has_released() const noexcept
+			{
+				return freeList != nullptr;
+			}
+
+			std::size_t block_size() const noexcept
+			{
+				return blockSize;
+			}
+
+		private:
+			struct node
+			{
+				node* next;
+			};
+
+			static std::size_t round_up(std::size_t value, std::size_t align)
+			{
+				return (value + align - 1) / align * align;
+			}
+
+			// blocks of a new slab are handed out sequentially, they are
+			// put into the free list only when released
+			void add_slab(std::size_t blocks)
+			{
+				unsigned char* slab = static_cast<unsigned char*>(
+					::operator new(slabHeader + blockSize * blocks));
+				*reinterpret_cast<void**>(slab) = slabs;
+				slabs = slab;
+				fresh = slab + slabHeader;
+				freshEnd = fresh + blockSize * blocks;
+			}
+
+			std::size_t blockAlign;
+			std::size_t blockSize;
+			std::size_t slabHeader;
+			std::size_t blocksPerSlab;
+			void* slabs{};
+			node* freeList{};
+			unsigned char* fresh{};
+			unsigned char* freshEnd{};
+		};
+
+		// blocks of one size shared by all threads, threads take and return
+		// them in batches, see thread_block_cache
+		class block_depot
+		{
+		public:
+			// free block, next links blocks of a batch, nextBatch links
+			// batches stored in the depot
+			struct node
+			{
+				node* next;
+				node* nextBatch;
+			};
+
+			block_depot(std::size_t size, std::size_t align)
+				: pool{ size < sizeof(node) ? sizeof(node) : size, align, 256 }
+			{
+			}
+
+			// batch of blocks linked by node::next, newly allocated ones
+			// if no batch was released
+			node* fetch(std::size_t count)
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				node* batch = batches;
+				if (batch)
+				{
+					batches = batch->nextBatch;
+					return batch;
+				}
+
+				try
+				{
+					for (; count; --count)
+					{
+						node* block = static_cast<node*>(pool.allocate());
+						block->next = batch;
+						batch = block;
+					}
+				}
+				catch (...)
+				{
+					if (!batch)
+					{
+						throw;
+					}
+				}
+				return batch;
+			}
+
+			void release(node* batch) noexcept
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				batch->nextBatch = batches;
+				batches = batch;
+			}
+
+			// single block for threads without a cache, taken from a
+			// released batch if there is one
+			void* allocate()
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				node* block = batches;
+				if (!block)
+				{
+					return pool.allocate();
+				}
+
+				if (block->next)
+				{
+					block->next->nextBatch = block->nextBatch;
+					batches = block->next;
+				}
+				else
+				{
+					batches = block->nextBatch;
+				}
+				return block;
+			}
+
+			void deallocate(void* block) noexcept
+			{
+				node* released = static_cast<node*>(block);
+				released->next = nullptr;
+				release(released);
+			}
+
+			// adds count new blocks in batches of batchSize
+			void reserve(std::size_t count, std::size_t batchSize)
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				const std::size_t blockSize = pool.block_size();
+				unsigned char* blocks = static_cast<unsigned char*>(
+					pool.allocate_contiguous(count));
+				touch_pages(blocks, blockSize * count);
+
+				for (std::size_t i = 0; i != count; ++i)
+				{
+					node* block = reinterpret_cast<node*>(blocks + blockSize * i);
+					if (i % batchSize == 0)
+					{
+						block->next = nullptr;
+						block->nextBatch = batches;
+						batches = block;
+					}
+					else
+					{
+						block->next = batches->next;
+						batches->next = block;
+					}
+				}
+			}
+
+		private:
+			std::mutex mutex;
+			slab_pool pool;
+			node* batches{};
+		};
+
+		// thread-local free list of blocks of Size bytes in front of a
+		// global block_depot shared by all products of that size. Threads
+		// take no locks until they run out of blocks or hold too many of
+		// them, then batch_size blocks move to or from the depot at once.
+		// Memory is never returned to the system
+		template<std::size_t Size, std::size_t Align>
+		class thread_block_cache
+		{
+			using node = block_depot::node;
+
+			struct cache
+			{
+				node* head{};
+				std::size_t count{};
+
+				~cache()
+				{
+					if (head)
+					{
+						depot().release(head);
+					}
+					cache_destroyed() = true;
+				}
+
+				void release(std::size_t blocks) noexcept
+				{
+					node* batch = head;
+					node* last = head;
+					for (std::size_t i = 1; i != blocks; ++i)
+					{
+						last = last->next;
+					}
+					head = last->next;
+					last->next = nullptr;
+					count -= blocks;
+					depot().release(batch);
+				}
+			};
+
+			// never destroyed, threads may release blocks after static
+			// destructors have run
+			static block_depot& depot()
+			{
+				static block_depot& instance = *new block_depot{ Size, Align };
+				return instance;
+			}
+
+			// trivial thread_local, stays valid after the cache is destroyed
+			static bool& cache_destroyed() noexcept
+			{
+				thread_local bool destroyed = false;
+				return destroyed;
+			}
+
+			// nullptr once the cache of this thread is destroyed, products
+			// destroyed by later thread_local destructors go to the depot
+			static cache* local_cache()
+			{
+				if (cache_destroyed())
+				{
+					return nullptr;
+				}
+				thread_local cache instance;
+				return &instance;
+			}
+
+		public:
+			static constexpr std::size_t batch_size = 32;
+
+			static void* allocate()
+			{
+				cache* local = local_cache();
+				if (!local)
+				{
+					return depot().allocate();
+				}
+
+				if (!local->head)
+				{
+					local->head = depot().fetch(batch_size);
+					for (node* block = local->head; block; block = block->next)
+					{
+						++local->count;
+					}
+				}
+
+				node* block = local->head;
+				local->head = block->next;
+				--local->count;
+				return block;
+			}
+
+			// puts count blocks into the depot, can be called by any thread
+			static void reserve(std::size_t count)
+			{
+				depot().reserve(count, batch_size);
+			}
+
+			static void deallocate(void* block) noexcept
+			{
+				cache* local = local_cache();
+				if (!local)
+				{
+					depot().deallocate(block);
+					return;
+				}
+
+				node* released = static_cast<node*>(block);
+				released->next = local->head;
+				local->head = released;
+				if (++local->count == 2 * batch_size)
+				{
+					local->release(batch_size);
+				}
+			}
+		};
+
+		// pointer that is replaced by writers while readers use it without
+		// locking. Readers register in the counter of the current epoch,
+		// writer switches epoch and waits until readers of the previous one
+		// are gone before destroying replaced value
+		template<typename T>
+		class rcu_cell
+		{
+		public:
+			explicit rcu_cell(std::unique_ptr<T> value = nullptr) noexcept
+				: current{ value.release() }
+			{
+			}
+
+			rcu_cell(const rcu_cell&) = delete;
+			rcu_cell& operator=(const rcu_cell&) = delete;
+
+			~rcu_cell()
+			{
+				delete current.load(std::memory_order_relaxed);
+			}
+
+			// calls fn with current value or nullptr, the value stays alive
+			// until fn returns
+			template<typename Fn>
+			auto read(Fn&& fn) const -> decltype(fn(static_cast<T*>(nullptr)))
+			{
+				read_guard guard{ *this };
+				return fn(current.load());
+			}
+
+			// replaces value, old one is returned when no reader can see it
+			std::unique_ptr<T> exchange(std::unique_ptr<T> value)
+			{
+				std::lock_guard<std::mutex> lock{ writer };
+				std::unique_ptr<T> previous{ current.exchange(value.release()) };
+
+				const unsigned previousEpoch = epoch.load();
+				epoch.store(previousEpoch + 1);
+				while (readers[previousEpoch & 1].load() != 0)
+				{
+					std::this_thread::yield();
+				}
+
+				return previous;
+			}
+
+			void store(std::unique_ptr<T> value)
+			{
+				exchange(std::move(value));
+			}
+
+		private:
+			class read_guard
+			{
+			public:
+				explicit read_guard(const rcu_cell& cell) noexcept
+				{
+					// retry if writer has switched epoch meanwhile, so that
+					// it either sees this reader or this reader sees new value
+					for (;;)
+					{
+						const unsigned readerEpoch = cell.epoch.load();
+						counter = &cell.readers[readerEpoch & 1];
+						counter->fetch_add(1);
+						if (cell.epoch.load() == readerEpoch)
+						{
+							break;
+						}
+						counter->fetch_sub(1);
+					}
+				}
+
+				read_guard(const read_guard&) = delete;
+				read_guard& operator=(const read_guard&) = delete;
+
+				~read_guard()
+				{
+					counter->fetch_sub(1, std::memory_order_release);
+				}
+
+			private:
+				std::atomic<std::size_t>* counter;
+			};
+
+			std::atomic<T*> current;
+			mutable std::atomic<unsigned> epoch{ 0 };
+			mutable std::atomic<std::size_t> readers[2]{ {0}, {0} };
+			std::mutex writer;
+		};
+	} //namespace utils
+
+	// unique_ptr deleter that hands product back to the creator that made it,
+	// default-constructed one falls back to plain delete
+	template<typename T>
+	class block_deleter
+	{
+	public:
+		using destroy_fn = void(*)(void*, T*);
+
+		block_deleter() noexcept = default;
+
+		block_deleter(destroy_fn destroy, void* context) noexcept
+			: destroy{ destroy }, context{ context }
+		{
+		}
+
+		destroy_fn get_destroy() const noexcept
+		{
+			return destroy;
+		}
+
+		void* get_context() const noexcept
+		{
+			return context;
+		}
+
+		void operator()(T* product) const
+		{
+			if (destroy)
+			{
+				destroy(context, product);
+			}
+			else
+			{
+				delete product;
+			}
+		}
+
+	private:
+		destroy_fn destroy{};
+		void* context{};
+	};
+
+	template<typename T>
+	using block_ptr = std::unique_ptr<T, block_deleter<T>>;
+
+	// reference counters of ref_counted, local_ref_count is for products
+	// that never leave one thread
+	class atomic_ref_count
+	{
+	public:
+		void increment() noexcept
+		{
+			count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// true when the last reference is gone
+		bool decrement() noexcept
+		{
+			if (count.fetch_sub(1, std::memory_order_release) != 1)
+			{
+				return false;
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return true;
+		}
+
+		std::size_t value() const noexcept
+		{
+			return count.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<std::size_t> count{ 0 };
+	};
+
+	class local_ref_count
+	{
+	public:
+		void increment() noexcept
+		{
+			++count;
+		}
+
+		bool decrement() noexcept
+		{
+			return --count == 0;
+		}
+
+		std::size_t value() const noexcept
+		{
+			return count;
+		}
+
+	private:
+		std::size_t count{ 0 };
+	};
+
+	// base of abstract products owned by intrusive_ptr, keeps reference
+	// count inside the product. Copies of the product start with no
+	// references
+	template<typename Counter = atomic_ref_count>
+	class ref_counted
+	{
+	public:
+		friend void intrusive_ptr_add_ref(const ref_counted* product) noexcept
+		{
+			product->references.increment();
+		}
+
+		friend void intrusive_ptr_release(const ref_counted* product) noexcept
+		{
+			if (product->references.decrement())
+			{
+				delete product;
+			}
+		}
+
+		friend std::size_t intrusive_ptr_use_count(const ref_counted* product) noexcept
+		{
+			return product->references.value();
+		}
+
+	protected:
+		ref_counted() noexcept = default;
+
+		ref_counted(const ref_counted&) noexcept
+		{
+		}
+
+		ref_counted& operator=(const ref_counted&) noexcept
+		{
+			return *this;
+		}
+
+		virtual ~ref_counted() = default;
+
+	private:
+		mutable Counter references;
+	};
+
+	// shared ownership of T through the counter inside it, no control
+	// block is allocated. T is usually derived from ref_counted, other
+	// types need intrusive_ptr_add_ref() and intrusive_ptr_release()
+	// found by argument-dependent lookup
+	template<typename T>
+	class intrusive_ptr
+	{
+	public:
+		using element_type = T;
+
+		intrusive_ptr() noexcept = default;
+
+		intrusive_ptr(std::nullptr_t) noexcept
+		{
+		}
+
+		explicit intrusive_ptr(T* product) noexcept
+			: product{ product }
+		{
+			if (product)
+			{
+				intrusive_ptr_add_ref(product);
+			}
+		}
+
+		intrusive_ptr(const intrusive_ptr& other) noexcept
+			: intrusive_ptr{ other.product }
+		{
+		}
+
+		intrusive_ptr(intrusive_ptr&& other) noexcept
+			: product{ other.product }
+		{
+			other.product = nullptr;
+		}
+
+		template<typename U,
+			typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type
+		>
+		intrusive_ptr(const intrusive_ptr<U>& other) noexcept
+			: intrusive_ptr{ other.get() }
+		{
+		}
+
+		template<typename U,
+			typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type
+		>
+		intrusive_ptr(intrusive_ptr<U>&& other) noexcept
+			: product{ other.release() }
+		{
+		}
+
+		~intrusive_ptr()
+		{
+			if (product)
+			{
+				intrusive_ptr_release(product);
+			}
+		}
+
+		intrusive_ptr& operator=(intrusive_ptr other) noexcept
+		{
+			swap(other);
+			return *this;
+		}
+
+		void reset() noexcept
+		{
+			intrusive_ptr{}.swap(*this);
+		}
+
+		void swap(intrusive_ptr& other) noexcept
+		{
+			T* current = product;
+			product = other.product;
+			other.product = current;
+		}
+
+		// gives up ownership without releasing the reference
+		T* release() noexcept
+		{
+			T* current = product;
+			product = nullptr;
+			return current;
+		}
+
+		T* get() const noexcept
+		{
+			return product;
+		}
+
+		T& operator*() const noexcept
+		{
+			return *product;
+		}
+
+		T* operator->() const noexcept
+		{
+			return product;
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return product != nullptr;
+		}
+
+		std::size_t use_count() const noexcept
+		{
+			return product ? intrusive_ptr_use_count(product) : 0;
+		}
+
+	private:
+		T* product{};
+	};
+
+	template<typename T, typename U>
+	bool operator==(const intrusive_ptr<T>& lhs, const intrusive_ptr<U>& rhs) noexcept
+	{
+		return lhs.get() == rhs.get();
+	}
+
+	template<typename T, typename U>
+	bool operator!=(const intrusive_ptr<T>& lhs, const intrusive_ptr<U>& rhs) noexcept
+	{
+		return lhs.get() != rhs.get();
+	}
+
+	template<typename T>
+	bool operator==(const intrusive_ptr<T>& lhs, std::nullptr_t) noexcept
+	{
+		return !lhs;
+	}
+
+	template<typename T>
+	bool operator!=(const intrusive_ptr<T>& lhs, std::nullptr_t) noexcept
+	{
+		return static_cast<bool>(lhs);
+	}
+
+	// move-only polymorphic handle that keeps product inside itself when it
+	// fits into Size bytes with Align alignment and is move constructible,
+	// otherwise product is allocated on the heap
+	template<
+		typename I,
+		std::size_t Size,
+		std::size_t Align = alignof(std::max_align_t)
+	>
+	class inplace_poly
+	{
+		static_assert(Size >= sizeof(void*) && Align >= alignof(void*),
+			"inplace_poly buffer should be able to hold a pointer");
+
+		enum class operation
+		{
+			move,
+			destroy
+		};
+
+		using manager_fn = I*(*)(operation, void*, void*);
+
+		template<typename Concrete>
+		using fits = std::integral_constant<bool, sizeof(Concrete) <= Size
+			&& Align % alignof(Concrete) == 0
+			&& std::is_move_constructible<Concrete>::value>;
+
+	public:
+		inplace_poly() noexcept = default;
+
+		inplace_poly(std::nullptr_t) noexcept
+		{
+		}
+
+		inplace_poly(inplace_poly&& other)
+		{
+			take(other);
+		}
+
+		inplace_poly& operator=(inplace_poly&& other)
+		{
+			if (this != &other)
+			{
+				reset();
+				take(other);
+			}
+			return *this;
+		}
+
+		~inplace_poly()
+		{
+			reset();
+		}
+
+		// destroys current product and creates Concrete from args
+		template<typename Concrete, typename... Args>
+		Concrete& emplace(Args&&... args)
+		{
+			static_assert(std::is_convertible<Concrete*, I*>::value,
+				"Concrete should be derived from I");
+
+			reset();
+			Concrete* concrete = construct<Concrete>(
+				fits<Concrete>{}, std::forward<Args>(args)...
+			);
+			object = concrete;
+			return *concrete;
+		}
+
+		void reset() noexcept
+		{
+			if (manager)
+			{
+				manager(operation::destroy, &buffer, nullptr);
+				manager = nullptr;
+				object = nullptr;
+			}
+		}
+
+		I* get() const noexcept
+		{
+			return object;
+		}
+
+		I* operator->() const noexcept
+		{
+			return object;
+		}
+
+		I& operator*() const noexcept
+		{
+			return *object;
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return object != nullptr;
+		}
+
+		bool is_inline() const noexcept
+		{
+			const unsigned char* first = reinterpret_cast<const unsigned char*>(&buffer);
+			const unsigned char* address = reinterpret_cast<const unsigned char*>(
+				static_cast<const void*>(object)
+			);
+			return object
+				&& !std::less<const unsigned char*>{}(address, first)
+				&& std::less<const unsigned char*>{}(address, first + Size);
+		}
+
+	private:
+		template<typename Concrete>
+		static I* manage_inline(operation op, void* from, void* to)
+		{
+			Concrete* concrete = static_cast<Concrete*>(from);
+			I* moved = nullptr;
+			if (op == operation::move)
+			{
+				moved = ::new(to) Concrete(std::move(*concrete));
+			}
+			concrete->~Concrete();
+			return moved;
+		}
+
+		template<typename Concrete>
+		static I* manage_heap(operation op, void* from, void* to)
+		{
+			Concrete* concrete = *static_cast<Concrete**>(from);
+			if (op == operation::move)
+			{
+				*static_cast<Concrete**>(to) = concrete;
+				return concrete;
+			}
+			delete concrete;
+			return nullptr;
+		}
+
+		template<typename Concrete, typename... Args>
+		Concrete* construct(std::true_type, Args&&... args)
+		{
+			Concrete* concrete = ::new(&buffer) Concrete(std::forward<Args>(args)...);
+			manager = &manage_inline<Concrete>;
+			return concrete;
+		}
+
+		template<typename Concrete, typename... Args>
+		Concrete* construct(std::false_type, Args&&... args)
+		{
+			Concrete* concrete = new Concrete(std::forward<Args>(args)...);
+			::new(&buffer) Concrete*(concrete);
+			manager = &manage_heap<Concrete>;
+			return concrete;
+		}
+
+		void take(inplace_poly& other)
+		{
+			if (other.manager)
+			{
+				object = other.manager(operation::move, &other.buffer, &buffer);
+				manager = other.manager;
+				other.manager = nullptr;
+				other.object = nullptr;
+			}
+		}
+
+		typename std::aligned_storage<Size, Align>::type buffer;
+		I* object{};
+		manager_fn manager{};
+	};
+
+	namespace utils
+	{
+		// product is created right inside the handle
+		template<typename I, std::size_t Size, std::size_t Align>
+		struct product_builder<inplace_poly<I, Size, Align>>
+		{
+			template<typename Concrete>
+			using is_buildable = std::is_convertible<Concrete*, I*>;
+
+			template<typename Concrete, typename Allocator, typename... Args>
+			static inplace_poly<I, Size, Align> create(const Allocator&, Args&&... args)
+			{
+				inplace_poly<I, Size, Align> product;
+				product.template emplace<Concrete>(std::forward<Args>(args)...);
+				return product;
+			}
+		};
+	} // namespace utils
+
+#ifdef GENERIC_ABSTRACT_FACTORY_STD_PMR
+	using std::pmr::memory_resource;
+	using std::pmr::polymorphic_allocator;
+	using std::pmr::new_delete_resource;
+	using std::pmr::get_default_resource;
+	using std::pmr::set_default_resource;
+#else
+	// C++11 counterpart of std::pmr::memory_resource, see
+	// GENERIC_ABSTRACT_FACTORY_STD_PMR
+	class memory_resource
+	{
+	public:
+		virtual ~memory_resource() = default;
+
+		void* allocate(std::size_t bytes,
+			std::size_t alignment = alignof(std::max_align_t))
+		{
+			return do_allocate(bytes, alignment);
+		}
+
+		void deallocate(void* p, std::size_t bytes,
+			std::size_t alignment = alignof(std::max_align_t))
+		{
+			do_deallocate(p, bytes, alignment);
+		}
+
+		bool is_equal(const memory_resource& other) const noexcept
+		{
+			return do_is_equal(other);
+		}
+
+	private:
+		virtual void* do_allocate(std::size_t bytes, std::size_t alignment) = 0;
+		virtual void do_deallocate(
+			void* p, std::size_t bytes, std::size_t alignment) = 0;
+		virtual bool do_is_equal(const memory_resource& other) const noexcept = 0;
+	};
+
+	inline bool operator==(const memory_resource& lhs, const memory_resource& rhs) noexcept
+	{
+		return &lhs == &rhs || lhs.is_equal(rhs);
+	}
+
+	inline bool operator!=(const memory_resource& lhs, const memory_resource& rhs) noexcept
+	{
+		return !(lhs == rhs);
+	}
+
+	namespace utils
+	{
+		class new_delete_resource_impl : public memory_resource
+		{
+			// over-aligned blocks keep original pointer right before the block
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override
+			{
+				if (alignment <= alignof(std::max_align_t))
+				{
+					return ::operator new(bytes);
+				}
+
+				void* raw = ::operator new(bytes + alignment + sizeof(void*));
+				const std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw)
+					+ sizeof(void*) + alignment - 1) & ~(alignment - 1);
+				reinterpret_cast<void**>(aligned)[-1] = raw;
+				return reinterpret_cast<void*>(aligned);
+			}
+
+			void do_deallocate(void* p, std::size_t, std::size_t alignment) override
+			{
+				if (alignment <= alignof(std::max_align_t))
+				{
+					::operator delete(p);
+				}
+				else
+				{
+					::operator delete(static_cast<void**>(p)[-1]);
+				}
+			}
+
+			bool do_is_equal(const memory_resource& other) const noexcept override
+			{
+				return this == &other;
+			}
+		};
+
+		inline std::atomic<memory_resource*>& default_resource() noexcept
+		{
+			static std::atomic<memory_resource*> resource{ nullptr };
+			return resource;
+		}
+	} // namespace utils
+
+	inline memory_resource* new_delete_resource() noexcept
+	{
+		static utils::new_delete_resource_impl resource;
+		return &resource;
+	}
+
+	inline memory_resource* get_default_resource() noexcept
+	{
+		memory_resource* resource = utils::default_resource().load();
+		return resource ? resource : new_delete_resource();
+	}
+
+	inline memory_resource* set_default_resource(memory_resource* resource) noexcept
+	{
+		memory_resource* previous = utils::default_resource().exchange(resource);
+		return previous ? previous : new_delete_resource();
+	}
+
+	// C++11 counterpart of std::pmr::polymorphic_allocator
+	template<typename T>
+	class polymorphic_allocator
+	{
+	public:
+		using value_type = T;
+
+		polymorphic_allocator() noexcept
+			: res{ get_default_resource() }
+		{
+		}
+
+		polymorphic_allocator(memory_resource* resource) noexcept
+			: res{ resource }
+		{
+		}
+
+		template<typename U>
+		polymorphic_allocator(const polymorphic_allocator<U>& other) noexcept
+			: res{ other.resource() }
+		{
+		}
+
+		T* allocate(std::size_t n)
+		{
+			return static_cast<T*>(res->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* p, std::size_t n)
+		{
+			res->deallocate(p, n * sizeof(T), alignof(T));
+		}
+
+		memory_resource* resource() const noexcept
+		{
+			return res;
+		}
+
+	private:
+		memory_resource* res;
+	};
+
+	template<typename T, typename U>
+	bool operator==(const polymorphic_allocator<T>& lhs,
+		const polymorphic_allocator<U>& rhs) noexcept
+	{
+		return *lhs.resource() == *rhs.resource();
+	}
+
+	template<typename T, typename U>
+	bool operator!=(const polymorphic_allocator<T>& lhs,
+		const polymorphic_allocator<U>& rhs) noexcept
+	{
+		return !(lhs == rhs);
+	}
+#endif
+
+	// bump allocator over chunks taken from upstream resource, deallocate()
+	// is no-op, reset() rewinds to the first chunk in O(1) keeping all chunks
+	// for reuse, release() returns them to upstream
+	class monotonic_arena : public memory_resource
+	{
+	public:
+		explicit monotonic_arena(std::size_t initialSize = 4096,
+			memory_resource* upstream = get_default_resource())
+			: nextSize{ initialSize ? initialSize : 1 }, upstream{ upstream }
+		{
+		}
+
+		monotonic_arena(const monotonic_arena&) = delete;
+		monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+		~monotonic_arena()
+		{
+			release();
+		}
+
+		void reset() noexcept
+		{
+			current = head;
+			position = head ? head->begin() : nullptr;
+		}
+
+		void release() noexcept
+		{
+			while (head)
+			{
+				chunk* next = head->next;
+				upstream->deallocate(head, sizeof(chunk) + head->size, alignof(chunk));
+				head = next;
+			}
+			current = nullptr;
+			position = nullptr;
+		}
+
+		memory_resource* upstream_resource() const noexcept
+		{
+			return upstream;
+		}
+
+	private:
+		struct alignas(std::max_align_t) chunk
+		{
+			chunk* next;
+			std::size_t size;
+
+			unsigned char* begin() noexcept
+			{
+				return reinterpret_cast<unsigned char*>(this + 1);
+			}
+
+			unsigned char* end() noexcept
+			{
+				return begin() + size;
+			}
+		};
+
+		static unsigned char* align_up(unsigned char* p, std::size_t alignment) noexcept
+		{
+			const std::uintptr_t value = reinterpret_cast<std::uintptr_t>(p);
+			return p + ((alignment - value % alignment) % alignment);
+		}
+
+		bool fits(chunk* target, std::size_t bytes, std::size_t alignment) noexcept
+		{
+			unsigned char* aligned = align_up(position, alignment);
+			if (aligned <= target->end()
+				&& static_cast<std::size_t>(target->end() - aligned) >= bytes)
+			{
+				position = aligned + bytes;
+				return true;
+			}
+			return false;
+		}
+
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			if (current && fits(current, bytes, alignment))
+			{
+				return position - bytes;
+			}
+
+			// reuse chunks kept by reset() before asking upstream
+			while (current && current->next)
+			{
+				current = current->next;
+				position = current->begin();
+				if (fits(current, bytes, alignment))
+				{
+					return position - bytes;
+				}
+			}
+
+			const std::size_t required = bytes + alignment;
+			const std::size_t size = nextSize < required ? required : nextSize;
+			chunk* fresh = static_cast<chunk*>(
+				upstream->allocate(sizeof(chunk) + size, alignof(chunk)));
+			fresh->next = nullptr;
+			fresh->size = size;
+			nextSize = size * 2;
+
+			if (current)
+			{
+				current->next = fresh;
+			}
+			else
+			{
+				head = fresh;
+			}
+			current = fresh;
+			position = fresh->begin();
+			fits(current, bytes, alignment);
+			return position - bytes;
+		}
+
+		void do_deallocate(void*, std::size_t, std::size_t) override
+		{
+		}
+
+		bool do_is_equal(const memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+
+		std::size_t nextSize;
+		memory_resource* upstream;
+		chunk* head{};
+		chunk* current{};
+		unsigned char* position{};
+	};
+
+	// root of the creators chain that gives every creator access to the
+	// memory resource of its concrete factory
+	template<typename AbstractFactory>
+	class memory_resource_root : public AbstractFactory
+	{
+	public:
+		memory_resource* get_memory_resource() const noexcept
+		{
+			return resource;
+		}
+
+		void set_memory_resource(memory_resource* newResource) noexcept
+		{
+			resource = newResource;
+		}
+
+	private:
+		memory_resource* resource{ get_default_resource() };
+	};
+
+	// storage needed to build a product in place, zero size means that
+	// creator can't do it
+	struct storage_requirements
+	{
+		std::size_t size;
+		std::size_t alignment;
+	};
+
+	namespace utils
+	{
+		template<typename Abstract, typename Concrete>
+		void destroy_in_place(void* concrete, Abstract*)
+		{
+			static_cast<Concrete*>(concrete)->~Concrete();
+		}
+
+		template<typename Abstract, typename Concrete>
+		using is_inplace_creatable = std::is_convertible<Concrete*, Abstract*>;
+
+		template<typename Abstract, typename Concrete>
+		storage_requirements storage_for()
+		{
+			return is_inplace_creatable<Abstract, Concrete>::value
+				? storage_requirements{ sizeof(Concrete), alignof(Concrete) }
+				: storage_requirements{ 0, 0 };
+		}
+
+		// constructs Concrete at the first suitably aligned address of the
+		// storage, empty pointer if it doesn't fit. Deleter of the product
+		// only runs its destructor
+		template<typename Abstract, typename Concrete, typename... Args>
+		block_ptr<Abstract> create_at(std::true_type, void* storage,
+			std::size_t size, Args&&... args)
+		{
+			if (!storage || !std::align(alignof(Concrete), sizeof(Concrete), storage, size))
+			{
+				return {};
+			}
+
+			Concrete* product = ::new(storage) Concrete(std::forward<Args>(args)...);
+			return block_ptr<Abstract>{
+				product,
+				block_deleter<Abstract>{ &destroy_in_place<Abstract, Concrete>, product }
+			};
+		}
+
+		template<typename Abstract, typename Concrete, typename... Args>
+		block_ptr<Abstract> create_at(std::false_type, void*, std::size_t, Args&&...)
+		{
+			return {};
+		}
+
+		class creator_interface_root
+		{
+		public:
+			virtual ~creator_interface_root() = default;
+		};
+	} // namespace utils
+
+	// optional creation functions, products opt in to them by listing tags
+	// in creation_features, e.g.
+	// using creation_features = utils::tl<batch_creation, inplace_creation>;
+	// create_n<>()
+	struct batch_creation {};
+	// create_at<>() and storage_for<>()
+	struct inplace_creation {};
+
+	namespace utils
+	{
+		template<typename Abstract, typename Feature>
+		using has_creation_feature = contains<
+			Feature, get_creation_features_t<Abstract>
+		>;
+	} // namespace utils
+
+	// creator interface for a single product stacked on top of Base, so that
+	// interfaces of several products can share one vtable pointer
+	template<typename...> class basic_creator_interface;
+
+	template<typename Abstract, typename Ret, typename... Args, typename Base>
+	class basic_creator_interface<utils::tl<Abstract, Ret, utils::tl<Args...>>, Base>
+		: public Base
+	{
+	public:
+		using context = utils::tl<Abstract, Ret, utils::tl<Args...>>;
+
+		virtual Ret create(utils::type_identity<Abstract>, Args...) = 0;
+	};
+
+	// create_n() of products with batch_creation
+	template<typename...> class batch_creator_interface;
+
+	template<typename Abstract, typename Ret, typename... Args, typename Base>
+	class batch_creator_interface<utils::tl<Abstract, Ret, utils::tl<Args...>>, Base>
+		: public Base
+	{
+	public:
+		// creates count products with one virtual call, args are copied for
+		// every product. Products with non-copyable args can't be batched
+		virtual std::vector<Ret> create_n(utils::type_identity<Abstract> tag,
+			std::size_t count, Args... args)
+		{
+			return utils::create_n<Ret, Args...>(
+				utils::are_reusable_args<Args...>{},
+				count,
+				[this, tag](Args... productArgs) {
+					return this->create(tag, std::forward<Args>(productArgs)...);
+				},
+				args...
+			);
+		}
+	};
+
+	// create_at() and storage_for() of products with inplace_creation
+	template<typename...> class inplace_creator_interface;
+
+	template<typename Abstract, typename Ret, typename... Args, typename Base>
+	class inplace_creator_interface<utils::tl<Abstract, Ret, utils::tl<Args...>>, Base>
+		: public Base
+	{
+	public:
+		// builds product in caller-supplied storage, empty pointer when it
+		// doesn't fit or creator can't build products in place. Storage
+		// has to outlive the product
+		virtual block_ptr<Abstract> create_at(utils::type_identity<Abstract>,
+			void*, std::size_t, Args...)
+		{
+			return {};
+		}
+
+		virtual storage_requirements storage_for(utils::type_identity<Abstract>) const
+		{
+			return { 0, 0 };
+		}
+	};
+
+	namespace utils
+	{
+		template<bool Enabled, template<typename...>class Layer, typename Context, typename Base>
+		using add_layer_t = typename std::conditional<
+			Enabled, Layer<Context, Base>, Base
+		>::type;
+
+		// create() interface with interfaces of creation_features on top,
+		// products without them pay only for create()
+		template<typename Context, typename Base>
+		using creator_interface_t = add_layer_t<
+			has_creation_feature<
+				typename context_abstract<Context>::type, batch_creation
+			>::value,
+			batch_creator_interface,
+			Context,
+			add_layer_t<
+				has_creation_feature<
+					typename context_abstract<Context>::type, inplace_creation
+				>::value,
+				inplace_creator_interface,
+				Context,
+				basic_creator_interface<Context, Base>
+			>
+		>;
+	} // namespace utils
+
+	template<typename...> class abstract_creator_interface;
+
+	template<typename Abstract, typename Ret, typename... Args>
+	class abstract_creator_interface<Abstract, Ret, utils::tl<Args...>>
+		: public utils::creator_interface_t<
+			utils::tl<Abstract, Ret, utils::tl<Args...>>,
+			utils::creator_interface_root
+		>
+	{
+	};
+
+	template<typename Abstract>
+	using default_abstract_creator = abstract_creator_interface<
+		Abstract,
+		utils::get_ret_type_t<
+			Abstract, utils::type_identity<std::unique_ptr<Abstract>>
+		>,
+		utils::get_ctor_args_t<Abstract>
+	>;
+
+	// passes class type arguments across the virtual call by reference,
+	// see utils::forwarded_arg. Rvalues are moved from the caller straight
+	// into the product, lvalues are copied once
+	template<typename Abstract>
+	using forwarding_abstract_creator = abstract_creator_interface<
+		Abstract,
+		utils::get_ret_type_t<
+			Abstract, utils::type_identity<std::unique_ptr<Abstract>>
+		>,
+		utils::forwarded_args_t<utils::get_ctor_args_t<Abstract>>
+	>;
+
+	// virtually inherited creator interface, abstract factory built from
+	// them can be used with flat_concrete_factory
+	template<typename Interface>
+	class virtual_creator_interface : public virtual Interface
+	{
+	};
+
+	template<typename Abstract>
+	using flat_abstract_creator = virtual_creator_interface<
+		default_abstract_creator<Abstract>
+	>;
+
+	namespace utils
+	{
+		// create_n() of concrete creators for products with batch_creation,
+		// products are created by Derived::create() without virtual dispatch.
+		// Derived that batches better hides create_batch() and befriends
+		// batch_concrete_creator
+		template<typename...> class batch_concrete_creator;
+
+		template<
+			typename Derived,
+			typename Abstract,
+			typename Ret,
+			typename... Args,
+			typename Base
+		>
+		class batch_concrete_creator<Derived, tl<Abstract, Ret, tl<Args...>>, Base>
+			: public Base
+		{
+		public:
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+			std::vector<Ret> create_n(type_identity<Abstract>,
+				std::size_t count, Args... args) final
+			{
+				return static_cast<Derived*>(this)->create_batch(count, args...);
+			}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+		protected:
+			template<typename... Ts>
+			std::vector<Ret> create_batch(std::size_t count, Ts&... args)
+			{
+				Derived* self = static_cast<Derived*>(this);
+				return utils::create_n<Ret, Args...>(
+					are_reusable_args<Args...>{},
+					count,
+					[self](Args... productArgs) {
+						return self->Derived::create(
+							type_identity<Abstract>{}, std::forward<Args>(productArgs)...
+						);
+					},
+					args...
+				);
+			}
+		};
+
+		// create_at() and storage_for() of concrete creators for products
+		// with inplace_creation, Derived that builds products differently
+		// hides create_in_place() and befriends inplace_concrete_creator
+		template<typename...> class inplace_concrete_creator;
+
+		template<
+			typename Derived,
+			typename Abstract,
+			typename Ret,
+			typename... Args,
+			typename Concrete,
+			typename Base
+		>
+		class inplace_concrete_creator<
+			Derived, tl<Abstract, Ret, tl<Args...>>, Concrete, Base
+		>
+			: public Base
+		{
+		public:
+			// storage that fits product built by create_at()
+			using storage_type = typename std::aligned_storage<
+				sizeof(Concrete), alignof(Concrete)
+			>::type;
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+			block_ptr<Abstract> create_at(type_identity<Abstract>,
+				void* storage, std::size_t size, Args... args) final
+			{
+				return static_cast<Derived*>(this)->create_in_place(
+					storage, size, std::forward<Args>(args)...
+				);
+			}
+
+			storage_requirements storage_for(type_identity<Abstract>) const final
+			{
+				return utils::storage_for<Abstract, Concrete>();
+			}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+		protected:
+			template<typename... Ts>
+			block_ptr<Abstract> create_in_place(void* storage, std::size_t size, Ts&&... args)
+			{
+				return utils::create_at<Abstract, Concrete>(
+					is_inplace_creatable<Abstract, Concrete>{},
+					storage, size, std::forward<Ts>(args)...
+				);
+			}
+		};
+
+		// Base of library concrete creators with implementations of
+		// creation_features of the product
+		template<typename Derived, typename Context, typename Concrete, typename Base>
+		struct concrete_creator_base
+		{
+			using abstract = typename context_abstract<Context>::type;
+
+			using inplace = typename std::conditional<
+				has_creation_feature<abstract, inplace_creation>::value,
+				inplace_concrete_creator<Derived, Context, Concrete, Base>,
+				Base
+			>::type;
+
+			using type = typename std::conditional<
+				has_creation_feature<abstract, batch_creation>::value,
+				batch_concrete_creator<Derived, Context, inplace>,
+				inplace
+			>::type;
+		};
+
+		template<typename Derived, typename Context, typename Concrete, typename Base>
+		using concrete_creator_base_t = typename concrete_creator_base<
+			Derived, Context, Concrete, Base
+		>::type;
+	} // namespace utils
+
+	template<typename...> class default_concrete_creator;
+
+	template<
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class default_concrete_creator<
+		utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public utils::concrete_creator_base_t<
+			default_concrete_creator<utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base>,
+			utils::tl<Abstract, Ret, utils::tl<Args...>>,
+			Concrete,
+			Base
+		>
+	{
+		static_assert(std::is_constructible<Concrete, Args...>::value,
+			"Product is not constructible from a given set of arguments");
+		static_assert(utils::product_builder<Ret>::template is_buildable<Concrete>::value,
+			"ret_type is not constructible from Concrete*");
+	public:
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args... args) final
+		{
+			return utils::product_builder<Ret>::template create<Concrete>(
+				std::allocator<Concrete>{}, std::forward<Args>(args)...
+			);
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	// shared_ptr products are created by std::allocate_shared() using
+	// Allocator, other ones by ret_type{ new Concrete(ctor_args...) }
+	template<typename...> class allocator_concrete_creator;
+
+	template<
+		typename Allocator,
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class allocator_concrete_creator<
+		Allocator, utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public utils::concrete_creator_base_t<
+			allocator_concrete_creator<Allocator, utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base>,
+			utils::tl<Abstract, Ret, utils::tl<Args...>>,
+			Concrete,
+			Base
+		>
+	{
+		static_assert(std::is_constructible<Concrete, Args...>::value,
+			"Product is not constructible from a given set of arguments");
+		static_assert(utils::product_builder<Ret>::template is_buildable<Concrete>::value,
+			"ret_type is not constructible from Concrete*");
+	public:
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args... args) final
+		{
+			return utils::product_builder<Ret>::template create<Concrete>(
+				Allocator{}, std::forward<Args>(args)...
+			);
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	// allocates products from a slab pool owned by the creator, so products
+	// must be released before the factory that created them is destroyed.
+	// Not thread-safe: the pool takes no locks, so products must be created
+	// and released by one thread at a time, see cached_pool_concrete_creator
+	template<typename...> class pool_concrete_creator;
+
+	template<
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class pool_concrete_creator<
+		utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public utils::concrete_creator_base_t<
+			pool_concrete_creator<utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base>,
+			utils::tl<Abstract, Ret, utils::tl<Args...>>,
+			Concrete,
+			Base
+		>
+	{
+		using element_type = utils::pointer_element_t<Ret>;
+
+		static_assert(std::is_constructible<Concrete, Args...>::value,
+			"Product is not constructible from a given set of arguments");
+		static_assert(std::is_constructible<
+				Ret, Concrete*, block_deleter<element_type>
+			>::value,
+			"ret_type is not constructible from Concrete* and block_deleter");
+		static_assert(alignof(Concrete) <= alignof(std::max_align_t),
+			"Over-aligned products are not supported by pool_concrete_creator");
+
+		utils::slab_pool pool{ sizeof(Concrete), alignof(Concrete) };
+
+		static void destroy(void* context, element_type* product)
+		{
+			Concrete* concrete = static_cast<Concrete*>(product);
+			concrete->~Concrete();
+			static_cast<utils::slab_pool*>(context)->deallocate(concrete);
+		}
+
+		// released blocks are reused first, the rest of the batch is placed
+		// in adjacent blocks never used before
+		template<typename... Ts>
+		std::vector<Ret> create_contiguous(std::true_type, std::size_t count,
+			Ts&... args)
+		{
+			std::vector<Ret> products;
+			products.reserve(count);
+			const auto release = [this](void* block) { pool.deallocate(block); };
+
+			for (; count && pool.has_released(); --count)
+			{
+				Concrete* product = utils::construct_at<Concrete>(
+					pool.allocate(), release,
+					static_cast<utils::reusable_arg_t<Args>>(args)...
+				);
+				products.push_back(Ret{
+					product, block_deleter<element_type>{ &destroy, &pool }
+				});
+			}
+
+			if (count)
+			{
+				utils::construct_n<Concrete, Args...>(
+					static_cast<unsigned char*>(pool.allocate_contiguous(count)),
+					pool.block_size(),
+					count,
+					release,
+					[this, &products](Concrete* product) {
+						products.push_back(Ret{
+							product, block_deleter<element_type>{ &destroy, &pool }
+						});
+					},
+					args...
+				);
+			}
+			return products;
+		}
+
+		template<typename... Ts>
+		std::vector<Ret> create_contiguous(std::false_type, std::size_t, Ts&...)
+		{
+			return {};
+		}
+
+		template<typename...> friend class utils::batch_concrete_creator;
+
+		template<typename... Ts>
+		std::vector<Ret> create_batch(std::size_t count, Ts&... args)
+		{
+			return create_contiguous(
+				utils::are_reusable_args<Args...>{}, count, args...
+			);
+		}
+	public:
+		// reserves count blocks, see basic_concrete_factory::prewarm()
+		friend void prewarm(pool_concrete_creator& self,
+			utils::type_identity<Abstract>, std::size_t count)
+		{
+			self.pool.reserve(count);
+		}
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args... args) final
+		{
+			Concrete* product = utils::construct_at<Concrete>(
+				pool.allocate(),
+				[this](void* block) { pool.deallocate(block); },
+				std::forward<Args>(args)...
+			);
+
+			return Ret{ product, block_deleter<element_type>{ &destroy, &pool } };
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	// pool_concrete_creator for products created and released by many
+	// threads: blocks come from thread-local caches in front of a global
+	// depot, see utils::thread_block_cache. Products can be released by
+	// any thread and may outlive the factory
+	template<typename...> class cached_pool_concrete_creator;
+
+	template<
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class cached_pool_concrete_creator<
+		utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public utils::concrete_creator_base_t<
+			cached_pool_concrete_creator<utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base>,
+			utils::tl<Abstract, Ret, utils::tl<Args...>>,
+			Concrete,
+			Base
+		>
+	{
+		using element_type = utils::pointer_element_t<Ret>;
+		using cache = utils::thread_block_cache<sizeof(Concrete), alignof(Concrete)>;
+
+		static_assert(std::is_constructible<Concrete, Args...>::value,
+			"Product is not constructible from a given set of arguments");
+		static_assert(std::is_constructible<
+				Ret, Concrete*, block_deleter<element_type>
+			>::value,
+			"ret_type is not constructible from Concrete* and block_deleter");
+		static_assert(alignof(Concrete) <= alignof(std::max_align_t),
+			"Over-aligned products are not supported by cached_pool_concrete_creator");
+
+		static void destroy(void*, element_type* product)
+		{
+			Concrete* concrete = static_cast<Concrete*>(product);
+			concrete->~Concrete();
+			cache::deallocate(concrete);
+		}
+
+		template<typename... Ts>
+		static Ret make(Ts&&... args)
+		{
+			Concrete* product = utils::construct_at<Concrete>(
+				cache::allocate(), &cache::deallocate, std::forward<Ts>(args)...
+			);
+
+			return Ret{ product, block_deleter<element_type>{ &destroy, nullptr } };
+		}
+	public:
+		// puts count blocks into the global depot, thread-safe
+		friend void prewarm(cached_pool_concrete_creator&,
+			utils::type_identity<Abstract>, std::size_t count)
+		{
+			cache::reserve(count);
+		}
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args... args) final
+		{
+			return make(std::forward<Args>(args)...);
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	// allocates products from the memory resource of memory_resource_root,
+	// shared_ptr products share single allocation with their control block.
+	// When Deallocate is false, deleters only run destructors and memory is
+	// reclaimed by the resource itself, e.g. by monotonic_arena::reset()
+	template<bool Deallocate, typename...> class basic_resource_concrete_creator;
+
+	template<
+		bool Deallocate,
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class basic_resource_concrete_creator<
+		Deallocate, utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public utils::concrete_creator_base_t<
+			basic_resource_concrete_creator<Deallocate, utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base>,
+			utils::tl<Abstract, Ret, utils::tl<Args...>>,
+			Concrete,
+			Base
+		>
+	{
+		using element_type = utils::pointer_element_t<Ret>;
+
+		static_assert(std::is_constructible<Concrete, Args...>::value,
+			"Product is not constructible from a given set of arguments");
+
+		static void destroy(void* context, element_type* product)
+		{
+			Concrete* concrete = static_cast<Concrete*>(product);
+			concrete->~Concrete();
+			if (Deallocate)
+			{
+				static_cast<memory_resource*>(context)->deallocate(
+					concrete, sizeof(Concrete), alignof(Concrete)
+				);
+			}
+		}
+
+		template<typename... Ts>
+		Ret make(std::true_type, Ts&&... args)
+		{
+			return utils::product_builder<Ret>::template create<Concrete>(
+				polymorphic_allocator<Concrete>{ this->get_memory_resource() },
+				std::forward<Ts>(args)...
+			);
+		}
+
+		template<typename... Ts>
+		Ret make(std::false_type, Ts&&... args)
+		{
+			static_assert(std::is_constructible<
+					Ret, Concrete*, block_deleter<element_type>
+				>::value,
+				"ret_type is not constructible from Concrete* and block_deleter");
+
+			memory_resource* resource = this->get_memory_resource();
+			Concrete* product = utils::construct_at<Concrete>(
+				resource->allocate(sizeof(Concrete), alignof(Concrete)),
+				[resource](void* block) {
+					resource->deallocate(block, sizeof(Concrete), alignof(Concrete));
+				},
+				std::forward<Ts>(args)...
+			);
+
+			return Ret{ product, block_deleter<element_type>{ &destroy, resource } };
+		}
+
+		// arena batches are a single allocation, products are never
+		// deallocated one by one so they can share it
+		using contiguous_batch = std::integral_constant<bool, !Deallocate
+			&& !utils::is_shared_ptr<Ret>::value
+			&& utils::are_reusable_args<Args...>::value>;
+
+		template<typename... Ts>
+		std::vector<Ret> make_n(std::true_type, std::size_t count, Ts&... args)
+		{
+			static_assert(std::is_constructible<
+					Ret, Concrete*, block_deleter<element_type>
+				>::value,
+				"ret_type is not constructible from Concrete* and block_deleter");
+
+			std::vector<Ret> products;
+			if (!count)
+			{
+				return products;
+			}
+
+			products.reserve(count);
+			memory_resource* resource = this->get_memory_resource();
+			utils::construct_n<Concrete, Args...>(
+				static_cast<unsigned char*>(resource->allocate(
+					sizeof(Concrete) * count, alignof(Concrete)
+				)),
+				sizeof(Concrete),
+				count,
+				[](void*) {},
+				[resource, &products](Concrete* product) {
+					products.push_back(Ret{
+						product, block_deleter<element_type>{ &destroy, resource }
+					});
+				},
+				args...
+			);
+			return products;
+		}
+
+		template<typename... Ts>
+		std::vector<Ret> make_n(std::false_type, std::size_t count, Ts&... args)
+		{
+			return utils::create_n<Ret, Args...>(
+				utils::are_reusable_args<Args...>{},
+				count,
+				[this](Args... productArgs) {
+					return make(
+						utils::is_shared_ptr<Ret>{}, std::forward<Args>(productArgs)...
+					);
+				},
+				args...
+			);
+		}
+
+		template<typename...> friend class utils::batch_concrete_creator;
+
+		template<typename... Ts>
+		std::vector<Ret> create_batch(std::size_t count, Ts&... args)
+		{
+			return make_n(contiguous_batch{}, count, args...);
+		}
+	public:
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args... args) final
+		{
+			return make(utils::is_shared_ptr<Ret>{}, std::forward<Args>(args)...);
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	template<typename... Ts>
+	using resource_concrete_creator = basic_resource_concrete_creator<true, Ts...>;
+
+	template<typename... Ts>
+	using arena_concrete_creator = basic_resource_concrete_creator<false, Ts...>;
+
+	// creates products by Clone() of the prototype set by set_prototype(),
+	// empty ret_type while there's none. Prototype can be replaced while
+	// other threads create products: create() doesn't lock and replaced
+	// prototype is destroyed once no create() uses it, so Clone() has to
+	// be safe to call concurrently. Constructor arguments are ignored
+	template<typename...> class prototype_concrete_creator;
+
+	template<
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class prototype_concrete_creator<
+		utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public Base
+	{
+		utils::rcu_cell<Abstract> prototype;
+
+	public:
+		friend void set_prototype(prototype_concrete_creator& self,
+			std::unique_ptr<Abstract> newPrototype)
+		{
+			self.prototype.store(std::move(newPrototype));
+		}
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args...) final
+		{
+			return prototype.read([](Abstract* current) -> Ret {
+				return current ? Ret(current->Clone()) : Ret{};
+			});
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	// state of recycled products of a single product type, see
+	// basic_recycling_concrete_creator
+	struct recycling_stats
+	{
+		std::uint64_t created;
+		// created products that reused a released one
+		std::uint64_t recycled;
+		// released products destroyed because free list was full
+		std::uint64_t discarded;
+		// released products waiting for reuse
+		std::size_t pooled;
+	};
+
+	namespace utils
+	{
+		template<typename Void, typename...>
+		struct is_resettable_impl : public std::false_type
+		{
+		};
+
+		template<typename Concrete, typename... Args>
+		struct is_resettable_impl<
+			void_t<decltype(std::declval<Concrete&>().reset(std::declval<Args>()...))>,
+			Concrete, Args...
+		>
+			: public std::true_type
+		{
+		};
+
+		// Concrete opts in to recycling by reset(ctor_args...) that brings
+		// released product to the state of a newly constructed one
+		template<typename Concrete, typename... Args>
+		struct is_resettable : public is_resettable_impl<void, Concrete, Args...>
+		{
+		};
+	} // namespace utils
+
+	// keeps up to Capacity released products in a free list and reuses them
+	// instead of constructing new ones. Products with reset(ctor_args...)
+	// stay alive in the list and are reinitialized by it, other products
+	// are destroyed on release and only their memory is reused. Like
+	// pool_concrete_creator it's not thread-safe and products must be
+	// released before the factory is destroyed
+	template<std::size_t Capacity, typename...> class basic_recycling_concrete_creator;
+
+	template<
+		std::size_t Capacity,
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class basic_recycling_concrete_creator<
+		Capacity, utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public utils::concrete_creator_base_t<
+			basic_recycling_concrete_creator<Capacity, utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base>,
+			utils::tl<Abstract, Ret, utils::tl<Args...>>,
+			Concrete,
+			Base
+		>
+	{
+		using element_type = utils::pointer_element_t<Ret>;
+		using resettable = utils::is_resettable<Concrete, Args...>;
+
+		static_assert(std::is_constructible<Concrete, Args...>::value,
+			"Product is not constructible from a given set of arguments");
+		static_assert(std::is_constructible<
+				Ret, Concrete*, block_deleter<element_type>
+			>::value,
+			"ret_type is not constructible from Concrete* and block_deleter");
+		static_assert(alignof(Concrete) <= alignof(std::max_align_t),
+			"Over-aligned products are not supported by recycling_concrete_creator");
+
+		// alive products if resettable, raw memory otherwise
+		void* released[Capacity ? Capacity : 1];
+		std::size_t releasedCount{};
+		recycling_stats stats{};
+
+		static void destroy(void* context, element_type* product)
+		{
+			static_cast<basic_recycling_concrete_creator*>(context)->recycle(
+				static_cast<Concrete*>(product)
+			);
+		}
+
+		static void deallocate(void* block) noexcept
+		{
+			::operator delete(block);
+		}
+
+		void recycle(Concrete* product)
+		{
+			if (releasedCount == Capacity)
+			{
+				++stats.discarded;
+				product->~Concrete();
+				deallocate(product);
+				return;
+			}
+
+			if (!resettable::value)
+			{
+				product->~Concrete();
+			}
+			released[releasedCount++] = product;
+		}
+
+		template<typename... Ts>
+		static void* preconstruct(std::true_type, Ts&... args)
+		{
+			return utils::construct_at<Concrete>(
+				::operator new(sizeof(Concrete)), &deallocate, args...
+			);
+		}
+
+		template<typename... Ts>
+		static void* preconstruct(std::false_type, Ts&...)
+		{
+			void* block = ::operator new(sizeof(Concrete));
+			utils::touch_pages(block, sizeof(Concrete));
+			return block;
+		}
+
+		template<typename... Ts>
+		Concrete* reuse(std::true_type, Ts&&... args)
+		{
+			Concrete* product = static_cast<Concrete*>(released[--releasedCount]);
+			try
+			{
+				product->reset(std::forward<Ts>(args)...);
+			}
+			catch (...)
+			{
+				product->~Concrete();
+				deallocate(product);
+				throw;
+			}
+			return product;
+		}
+
+		template<typename... Ts>
+		Concrete* reuse(std::false_type, Ts&&... args)
+		{
+			return utils::construct_at<Concrete>(
+				released[--releasedCount],
+				[this](void* block) { released[releasedCount++] = block; },
+				std::forward<Ts>(args)...
+			);
+		}
+	public:
+		basic_recycling_concrete_creator() = default;
+		basic_recycling_concrete_creator(const basic_recycling_concrete_creator&) = delete;
+		basic_recycling_concrete_creator& operator=(
+			const basic_recycling_concrete_creator&) = delete;
+
+		~basic_recycling_concrete_creator()
+		{
+			while (releasedCount)
+			{
+				void* block = released[--releasedCount];
+				if (resettable::value)
+				{
+					static_cast<Concrete*>(block)->~Concrete();
+				}
+				deallocate(block);
+			}
+		}
+
+		friend recycling_stats recycling_stats_of(
+			const basic_recycling_concrete_creator& self, utils::type_identity<Abstract>)
+		{
+			recycling_stats result = self.stats;
+			result.pooled = self.releasedCount;
+			return result;
+		}
+
+		// fills free list with up to count products constructed from args,
+		// only memory is prepared for products without reset()
+		template<typename... Ts,
+			typename = typename std::enable_if<
+				!resettable::value || std::is_constructible<Concrete, Ts&...>::value
+			>::type
+		>
+		friend void prewarm(basic_recycling_concrete_creator& self,
+			utils::type_identity<Abstract>, std::size_t count, Ts&&... args)
+		{
+			for (; count && self.releasedCount != Capacity; --count)
+			{
+				self.released[self.releasedCount] = self.preconstruct(resettable{}, args...);
+				++self.releasedCount;
+			}
+		}
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args... args) final
+		{
+			Concrete* product = nullptr;
+			if (releasedCount)
+			{
+				product = reuse(resettable{}, std::forward<Args>(args)...);
+				++stats.recycled;
+			}
+			else
+			{
+				product = utils::construct_at<Concrete>(
+					::operator new(sizeof(Concrete)), &deallocate,
+					std::forward<Args>(args)...
+				);
+			}
+			++stats.created;
+
+			return Ret{ product, block_deleter<element_type>{ &destroy, this } };
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	template<typename... Ts>
+	using recycling_concrete_creator = basic_recycling_concrete_creator<16, Ts...>;
+
+	namespace utils
+	{
+		// prewarm() is found by argument-dependent lookup among friends of
+		// the creator
+		template<typename Creator, typename Abstract, typename... Args>
+		auto prewarm_creator(Creator& creator, std::size_t count, Args&&... args)
+			-> decltype(prewarm(creator, type_identity<Abstract>{}, count,
+				std::forward<Args>(args)...))
+		{
+			return prewarm(creator, type_identity<Abstract>{}, count,
+				std::forward<Args>(args)...);
+		}
+
+		template<typename Void, typename...>
+		struct is_prewarmable_impl : public std::false_type
+		{
+		};
+
+		template<typename Creator, typename Abstract, typename... Args>
+		struct is_prewarmable_impl<
+			void_t<decltype(prewarm_creator<Creator, Abstract>(
+				std::declval<Creator&>(), std::size_t{}, std::declval<Args>()...))>,
+			Creator, Abstract, Args...
+		>
+			: public std::true_type
+		{
+		};
+
+		// whether Creator can prewarm Abstract from args
+		template<typename Creator, typename Abstract, typename... Args>
+		struct is_prewarmable : public is_prewarmable_impl<void, Creator, Abstract, Args...>
+		{
+		};
+	} // namespace utils
+
+	// creation statistics of a single product, see instrument
+	struct product_stats_snapshot
+	{
+		static constexpr std::size_t latency_buckets = 64;
+
+		std::uint64_t created;
+		std::uint64_t destroyed;
+		// created * sizeof of the concrete product, memory of allocator
+		// headers, pool blocks and shared_ptr control blocks isn't included
+		std::uint64_t object_bytes;
+		// latency[i] is the number of create() calls that took
+		// [2^i, 2^(i+1)) nanoseconds, bucket 0 also counts zero
+		std::uint64_t latency[latency_buckets];
+
+		std::uint64_t live() const noexcept
+		{
+			return created - destroyed;
+		}
+
+		// upper bound of q-th latency quantile in nanoseconds, 0 if no
+		// create() was timed
+		std::uint64_t latency_quantile(double q) const noexcept
+		{
+			std::uint64_t total = 0;
+			for (std::uint64_t count : latency)
+			{
+				total += count;
+			}
+
+			const double rank = q * static_cast<double>(total);
+			std::uint64_t seen = 0;
+			for (std::size_t i = 0; total && i != latency_buckets; ++i)
+			{
+				seen += latency[i];
+				if (seen && static_cast<double>(seen) >= rank)
+				{
+					return i + 1 == latency_buckets
+						? ~std::uint64_t{ 0 }
+						: (std::uint64_t{ 1 } << (i + 1)) - 1;
+				}
+			}
+			return 0;
+		}
+	};
+
+	// statistics of one instrumented creator. Hooked deleters of products
+	// keep a pointer to it, so it's freed by whoever is the last of the
+	// creator and its products, on_destroy() and release() tell them
+	class product_stats
+	{
+	public:
+		product_stats() = default;
+		product_stats(const product_stats&) = delete;
+		product_stats& operator=(const product_stats&) = delete;
+
+		// product whose destruction will be reported by on_destroy()
+		void on_construct() noexcept
+		{
+			created.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// product whose destruction can't be seen
+		void on_construct_untracked() noexcept
+		{
+			untracked.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// true if the creator is gone and this was its last product
+		bool on_destroy() noexcept
+		{
+			const std::uint64_t previous = destroyed.fetch_add(1, std::memory_order_acq_rel);
+			return (previous & released) && (previous & ~released) + 1
+				== created.load(std::memory_order_relaxed);
+		}
+
+		void on_create(std::uint64_t nanoseconds) noexcept
+		{
+			std::size_t bucket = 0;
+			for (std::size_t shift = 32; shift; shift >>= 1)
+			{
+				if (nanoseconds >> shift)
+				{
+					nanoseconds >>= shift;
+					bucket += shift;
+				}
+			}
+			latency[bucket].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// called by the creator on destruction, true if no product is left
+		bool release() noexcept
+		{
+			const std::uint64_t previous = destroyed.fetch_add(
+				released, std::memory_order_acq_rel
+			);
+			return previous == created.load(std::memory_order_relaxed);
+		}
+
+		product_stats_snapshot snapshot(std::size_t objectSize) const noexcept
+		{
+			product_stats_snapshot result;
+			const std::uint64_t tracked = created.load(std::memory_order_relaxed);
+			result.created = tracked + untracked.load(std::memory_order_relaxed);
+			result.destroyed = destroyed.load(std::memory_order_relaxed) & ~released;
+			if (result.destroyed > tracked)
+			{
+				result.destroyed = tracked;
+			}
+			result.object_bytes = result.created * objectSize;
+			for (std::size_t i = 0; i != product_stats_snapshot::latency_buckets; ++i)
+			{
+				result.latency[i] = latency[i].load(std::memory_order_relaxed);
+			}
+			return result;
+		}
+
+	private:
+		static constexpr std::uint64_t released = std::uint64_t{ 1 } << 63;
+
+		std::atomic<std::uint64_t> created{ 0 };
+		std::atomic<std::uint64_t> untracked{ 0 };
+		// high bit is set once the creator is gone
+		std::atomic<std::uint64_t> destroyed{ 0 };
+		std::atomic<std::uint64_t> latency[product_stats_snapshot::latency_buckets]{};
+	};
+
+	// instrumentation policies of instrument
+	struct no_instrumentation {};
+	struct count_instrumentation {};
+	struct latency_instrumentation {};
+
+	namespace utils
+	{
+		// product_stats of instrumented creator of Abstract with deleters
+		// that hooked block_ptr products chain to. Products of create() and
+		// create_n() share one deleter, in-place ones pass their own address
+		// as deleter context, so only its offset from the product is kept
+		template<typename Abstract>
+		class hooked_stats : public product_stats
+		{
+			using destroy_fn = typename block_deleter<Abstract>::destroy_fn;
+
+			std::atomic<destroy_fn> owned{ nullptr };
+			std::atomic<void*> ownedContext{ nullptr };
+			std::atomic<destroy_fn> inPlace{ nullptr };
+			std::atomic<std::uintptr_t> inPlaceOffset{ 0 };
+
+			// stores are skipped when deleter is the same as before, so
+			// creating threads don't write to the shared cache line
+			template<typename T>
+			static void remember(std::atomic<T>& slot, T value) noexcept
+			{
+				if (slot.load(std::memory_order_relaxed) != value)
+				{
+					slot.store(value, std::memory_order_relaxed);
+				}
+			}
+
+			static void destroy_owned(void* context, Abstract* product)
+			{
+				hooked_stats* self = static_cast<hooked_stats*>(context);
+				block_deleter<Abstract>{
+					self->owned.load(std::memory_order_relaxed),
+					self->ownedContext.load(std::memory_order_relaxed)
+				}(product);
+				self->on_hooked_destroy();
+			}
+
+			static void destroy_in_place(void* context, Abstract* product)
+			{
+				hooked_stats* self = static_cast<hooked_stats*>(context);
+				block_deleter<Abstract>{
+					self->inPlace.load(std::memory_order_relaxed),
+					reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(product)
+						+ self->inPlaceOffset.load(std::memory_order_relaxed))
+				}(product);
+				self->on_hooked_destroy();
+			}
+
+		public:
+			// deleters of hooked products call it instead of on_destroy()
+			void on_hooked_destroy() noexcept
+			{
+				if (on_destroy())
+				{
+					delete this;
+				}
+			}
+
+			// counts the product and replaces its deleter with one that also
+			// counts destruction
+			block_ptr<Abstract> hook(block_ptr<Abstract> product, bool createdInPlace)
+			{
+				if (!product)
+				{
+					return product;
+				}
+
+				const block_deleter<Abstract>& chained = product.get_deleter();
+				if (createdInPlace)
+				{
+					remember(inPlace, chained.get_destroy());
+					remember(inPlaceOffset, reinterpret_cast<std::uintptr_t>(chained.get_context())
+						- reinterpret_cast<std::uintptr_t>(product.get()));
+				}
+				else
+				{
+					remember(owned, chained.get_destroy());
+					remember(ownedContext, chained.get_context());
+				}
+				on_construct();
+				return block_ptr<Abstract>{
+					product.release(),
+					block_deleter<Abstract>{
+						createdInPlace ? &destroy_in_place : &destroy_owned, this
+					}
+				};
+			}
+
+			// called by the creator instead of delete
+			void release_creator() noexcept
+			{
+				if (release())
+				{
+					delete this;
+				}
+			}
+		};
+
+		template<typename Ret>
+		auto is_empty_product(const Ret& product, int) -> decltype(!product)
+		{
+			return !product;
+		}
+
+		template<typename Ret>
+		bool is_empty_product(const Ret&, long)
+		{
+			return false;
+		}
+
+		// counts products returned by instrumented creator and, where
+		// deleter of ret_type can be replaced, their destruction. Products
+		// of other ret_types, e.g. raw pointers and std::unique_ptr with
+		// default deleter, are only counted
+		template<typename Ret, typename Abstract>
+		struct deleter_hook
+		{
+			static Ret attach(hooked_stats<Abstract>& stats, Ret product)
+			{
+				if (!is_empty_product(product, 0))
+				{
+					stats.on_construct_untracked();
+				}
+				return product;
+			}
+		};
+
+		template<typename Abstract>
+		struct deleter_hook<block_ptr<Abstract>, Abstract>
+		{
+			static block_ptr<Abstract> attach(hooked_stats<Abstract>& stats,
+				block_ptr<Abstract> product)
+			{
+				return stats.hook(std::move(product), false);
+			}
+		};
+
+		// shared_ptr can't change deleter of its control block, so product
+		// gets another one that owns the returned pointer
+		template<typename T, typename Abstract>
+		struct deleter_hook<std::shared_ptr<T>, Abstract>
+		{
+			class deleter
+			{
+			public:
+				deleter(std::shared_ptr<T> product, hooked_stats<Abstract>* stats) noexcept
+					: product(std::move(product))
+					, stats(stats)
+				{
+				}
+
+				void operator()(T*) noexcept
+				{
+					product.reset();
+					stats->on_hooked_destroy();
+				}
+
+			private:
+				std::shared_ptr<T> product;
+				hooked_stats<Abstract>* stats;
+			};
+
+			static std::shared_ptr<T> attach(hooked_stats<Abstract>& stats,
+				std::shared_ptr<T> product)
+			{
+				if (!product)
+				{
+					return product;
+				}
+
+				stats.on_construct();
+				T* raw = product.get();
+				return std::shared_ptr<T>(raw, deleter{ std::move(product), &stats });
+			}
+		};
+
+		// root of the wrapped creator, gives it access to the memory
+		// resource and singleton registry of the instrumented one
+		template<typename Outer, typename Context>
+		class instrumented_root
+			: public creator_interface_t<Context, creator_interface_root>
+		{
+			friend Outer;
+
+			Outer* outer{};
+
+		public:
+			template<typename T = Outer>
+			auto get_memory_resource() const noexcept
+				-> decltype(std::declval<const T&>().get_memory_resource())
+			{
+				return outer->get_memory_resource();
+			}
+
+			template<typename T = Outer>
+			auto get_singleton_registry() noexcept
+				-> decltype(std::declval<T&>().get_singleton_registry())
+			{
+				return outer->get_singleton_registry();
+			}
+		};
+
+		template<typename Policy>
+		class create_timer
+		{
+		public:
+			explicit create_timer(product_stats*) noexcept
+			{
+			}
+		};
+
+		template<>
+		class create_timer<latency_instrumentation>
+		{
+		public:
+			explicit create_timer(product_stats* productStats) noexcept
+				: stats(productStats)
+				, start(std::chrono::steady_clock::now())
+			{
+			}
+
+			~create_timer()
+			{
+				stats->on_create(static_cast<std::uint64_t>(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - start
+					).count()
+				));
+			}
+
+		private:
+			product_stats* stats;
+			std::chrono::steady_clock::time_point start;
+		};
+
+		template<template<typename...>class Creator, typename Policy, typename...>
+		class instrumented_creator;
+
+		template<
+			template<typename...>class Creator,
+			typename Policy,
+			typename Abstract,
+			typename Ret,
+			typename... Args,
+			typename Concrete,
+			typename Base
+		>
+		class instrumented_creator<
+			Creator, Policy, tl<Abstract, Ret, tl<Args...>>, Concrete, Base
+		>
+			: public concrete_creator_base_t<
+				instrumented_creator<
+					Creator, Policy, tl<Abstract, Ret, tl<Args...>>, Concrete, Base
+				>,
+				tl<Abstract, Ret, tl<Args...>>,
+				Concrete,
+				Base
+			>
+		{
+			using context = tl<Abstract, Ret, tl<Args...>>;
+			using root = instrumented_root<instrumented_creator, context>;
+			using creator = Creator<context, Concrete, root>;
+			using hook = deleter_hook<Ret, Abstract>;
+
+			creator wrapped;
+			hooked_stats<Abstract>* stats{ new hooked_stats<Abstract> };
+
+			template<typename...> friend class utils::batch_concrete_creator;
+			template<typename...> friend class utils::inplace_concrete_creator;
+
+			template<typename... Ts>
+			std::vector<Ret> create_batch(std::size_t count, Ts&... args)
+			{
+				std::vector<Ret> products = wrapped.create_n(
+					type_identity<Abstract>{}, count, args...
+				);
+				for (Ret& product : products)
+				{
+					product = hook::attach(*stats, std::move(product));
+				}
+				return products;
+			}
+
+			template<typename... Ts>
+			block_ptr<Abstract> create_in_place(void* storage, std::size_t size, Ts&&... args)
+			{
+				return stats->hook(wrapped.create_at(
+					type_identity<Abstract>{}, storage, size, std::forward<Ts>(args)...
+				), true);
+			}
+
+		public:
+			instrumented_creator()
+			{
+				static_cast<root&>(wrapped).outer = this;
+			}
+
+			instrumented_creator(const instrumented_creator&) = delete;
+			instrumented_creator& operator=(const instrumented_creator&) = delete;
+
+			~instrumented_creator()
+			{
+				stats->release_creator();
+			}
+
+			friend product_stats_snapshot product_stats_of(
+				const instrumented_creator& self, type_identity<Abstract>) noexcept
+			{
+				return self.stats->snapshot(sizeof(Concrete));
+			}
+
+			// creator that does the work, e.g. for recycling_stats_of()
+			friend creator& wrapped_creator(instrumented_creator& self,
+				type_identity<Abstract>) noexcept
+			{
+				return self.wrapped;
+			}
+
+			template<typename... Ts>
+			friend auto prewarm(instrumented_creator& self, type_identity<Abstract>,
+				std::size_t count, Ts&&... args)
+				-> decltype(prewarm_creator<creator, Abstract>(
+					self.wrapped, count, std::forward<Ts>(args)...))
+			{
+				return prewarm_creator<creator, Abstract>(
+					self.wrapped, count, std::forward<Ts>(args)...
+				);
+			}
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+			Ret create(type_identity<Abstract>, Args... args) final
+			{
+				const create_timer<Policy> timer{ stats };
+				(void)timer;
+				return hook::attach(*stats, wrapped.create(
+					type_identity<Abstract>{}, std::forward<Args>(args)...
+				));
+			}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+		};
+
+		template<typename Contexts>
+		struct stats_dumper;
+
+		template<typename... Contexts>
+		struct stats_dumper<tl<Contexts...>>
+		{
+			template<typename Abstract, typename Factory, typename Fn>
+			static auto dump(int, const Factory& factory, Fn& fn, std::size_t id)
+				-> decltype(product_stats_of(factory, type_identity<Abstract>{}), void())
+			{
+				fn(id, product_stats_of(factory, type_identity<Abstract>{}));
+			}
+
+			template<typename Abstract, typename Factory, typename Fn>
+			static void dump(long, const Factory&, Fn&, std::size_t)
+			{
+			}
+
+			template<typename Factory, typename Fn>
+			static void dump(const Factory& factory, Fn& fn)
+			{
+				std::size_t id = 0;
+				const int expand[] = { 0, (dump<
+					typename context_abstract<Contexts>::type
+				>(0, factory, fn, id++), 0)... };
+				(void)expand;
+			}
+		};
+	} // namespace utils
+
+	// wraps concrete creator to collect product_stats of its factory:
+	// counts of returned and destroyed products, and with
+	// latency_instrumentation also latency of create(). Wrapped creator is
+	// a member with the same context and product, returned products are
+	// counted and get deleters that count their destruction, see
+	// utils::deleter_hook. With no_instrumentation creator is Creator itself
+	template<
+		template<typename...>class Creator,
+		typename Policy = count_instrumentation
+	>
+	struct instrument
+	{
+		template<typename Context, typename Concrete, typename Base>
+		using creator = utils::instrumented_creator<Creator, Policy, Context, Concrete, Base>;
+	};
+
+	template<template<typename...>class Creator>
+	struct instrument<Creator, no_instrumentation>
+	{
+		template<typename Context, typename Concrete, typename Base>
+		using creator = Creator<Context, Concrete, Base>;
+	};
+
+	// calls fn(id, product_stats_snapshot) for every instrumented product of
+	// concrete factory, id is position of product in context_list. Does
+	// nothing with no_instrumentation
+	template<typename ConcreteFactory, typename Fn>
+	void dump_product_stats(const ConcreteFactory& factory, Fn&& fn)
+	{
+		utils::stats_dumper<typename ConcreteFactory::context_list>::dump(factory, fn);
+	}
+
+	namespace utils
+	{
+		template<std::size_t...> struct index_sequence {};
+
+		template<std::size_t N, std::size_t... Is>
+		struct make_index_sequence_impl
+			: public make_index_sequence_impl<N - 1, N - 1, Is...>
+		{
+		};
+
+		template<std::size_t... Is>
+		struct make_index_sequence_impl<0, Is...>
+		{
+			using type = index_sequence<Is...>;
+		};
+
+		template<std::size_t N>
+		using make_index_sequence = typename make_index_sequence_impl<N>::type;
+
+		// product of factory.create<Abstract>() from stored copies of
+		// arguments, e.g. of create_async() and create_lazy()
+		template<typename Factory, typename Abstract, typename... Args>
+		using factory_ret_t = decltype(std::declval<Factory&>().template create<Abstract>(
+			std::declval<typename std::decay<Args>::type>()...
+		));
+	} // namespace utils
+
+	namespace utils
+	{
+		// front end shared by abstract factories: Bases are the creator
+		// interfaces the factory inherits, Interface<Abstract> is the one
+		// that creates Abstract
+		template<
+			typename AbstractList,
+			template<typename...>class Interface,
+			typename... Bases
+		>
+		class basic_abstract_factory;
+
+		template<
+			typename... AbstractList,
+			template<typename...>class Interface,
+			typename... Bases
+		>
+		class basic_abstract_factory<tl<AbstractList...>, Interface, Bases...>
+			: protected Bases...
+		{
+		public:
+			using context_list = tl<typename Interface<AbstractList>::context...>;
+
+			template<typename Abstract, typename... Args,
+				typename = typename std::enable_if<std::is_base_of<
+					Interface<Abstract>,
+					basic_abstract_factory
+				>::value>::type
+			>
+			auto create(Args&& ...args) ->
+				decltype(Interface<Abstract>::create(
+					type_identity<Abstract>{}, std::forward<Args>(args)...)
+				)
+			{
+				Interface<Abstract>* creator = this;
+
+				return creator->create(
+					type_identity<Abstract>{}, std::forward<Args>(args)...
+				);
+			}
+
+			template<typename Abstract, typename... Args, 
+				typename = typename std::enable_if<!std::is_base_of<
+					Interface<Abstract>,
+					basic_abstract_factory
+				>::value  
+				|| !is_invocable_memfn<
+					decltype(&Interface<Abstract>::create),
+					type_identity<Abstract>,
+					Args...
+				>::value>::type>
+			convertible_to_any create(Args && ...)
+			{
+				static_assert(std::is_base_of<
+						Interface<Abstract>,
+						basic_abstract_factory
+					>::value,
+					"abstract_factory::create(): wrong product type"
+				);
+				
+				static_assert(is_invocable_memfn<
+						decltype(&Interface<Abstract>::create),
+						type_identity<Abstract>,
+						Args...
+					>::value,
+					"abstract_factory::create(): wrong arguments"
+				);
+				
+				return {};
+			}
+
+			// creates count products with a single virtual call, arguments are
+			// copied for every product. Product has to opt in to batch_creation
+			template<typename Abstract, typename... Args>
+			std::vector<typename context_ret<
+				typename Interface<Abstract>::context
+			>::type> create_n(std::size_t count, Args&& ...args)
+			{
+				static_assert(std::is_base_of<Interface<Abstract>, basic_abstract_factory>::value,
+					"abstract_factory::create_n(): wrong product type"
+				);
+
+				static_assert(has_creation_feature<Abstract, batch_creation>::value,
+					"abstract_factory::create_n(): product doesn't opt in to batch_creation"
+				);
+
+				static_assert(is_batch_creatable<
+						typename Interface<Abstract>::context
+					>::value,
+					"abstract_factory::create_n(): arguments can't be copied"
+				);
+
+				Interface<Abstract>* creator = this;
+
+				return creator->create_n(
+					type_identity<Abstract>{}, count, std::forward<Args>(args)...
+				);
+			}
+
+			// builds product in caller-supplied storage of given size, empty
+			// pointer when it doesn't fit, see storage_for(). Product has to
+			// opt in to inplace_creation
+			template<typename Abstract, typename... Args>
+			block_ptr<Abstract> create_at(void* storage, std::size_t size, Args&& ...args)
+			{
+				static_assert(std::is_base_of<Interface<Abstract>, basic_abstract_factory>::value,
+					"abstract_factory::create_at(): wrong product type"
+				);
+
+				static_assert(has_creation_feature<Abstract, inplace_creation>::value,
+					"abstract_factory::create_at(): product doesn't opt in to inplace_creation"
+				);
+
+				Interface<Abstract>* creator = this;
+
+				return creator->create_at(
+					type_identity<Abstract>{}, storage, size, std::forward<Args>(args)...
+				);
+			}
+
+			template<typename Abstract>
+			storage_requirements storage_for() const
+			{
+				static_assert(std::is_base_of<Interface<Abstract>, basic_abstract_factory>::value,
+					"abstract_factory::storage_for(): wrong product type"
+				);
+
+				static_assert(has_creation_feature<Abstract, inplace_creation>::value,
+					"abstract_factory::storage_for(): product doesn't opt in to inplace_creation"
+				);
+
+				const Interface<Abstract>* creator = this;
+
+				return creator->storage_for(type_identity<Abstract>{});
+			}
+
+			// position of Abstract in context_list, id of product for create_by_id()
+			template<typename Abstract>
+			static constexpr std::size_t id_of()
+			{
+				return index_of<Abstract, tl<AbstractList...>>::value;
+			}
+
+			// creates product chosen at run time by its id through a jump table
+			// and stores it to product. Returns false and leaves product intact
+			// if id is out of range or that product can't be created from args
+			// as R. Enum ids should have values given by id_of()
+			template<typename R, typename Id, typename... Args>
+			bool create_by_id(Id id, R& product, Args&& ...args)
+			{
+				static_assert(!all_of<
+					!is_creatable_as<R, Interface<AbstractList>, AbstractList, Args...>::value...
+				>::value,
+					"abstract_factory::create_by_id(): no product can be created as R from given arguments"
+				);
+
+				using entry = bool(*)(basic_abstract_factory&, R&, Args&&...);
+				static constexpr entry table[] = {
+					&create_entry<R, AbstractList, Args...>...
+				};
+
+				const std::size_t index = static_cast<std::size_t>(id);
+				return index < sizeof...(AbstractList)
+					&& table[index](*this, product, std::forward<Args>(args)...);
+			}
+
+		private:
+			template<typename R, typename Abstract, typename... Args>
+			static bool create_entry(basic_abstract_factory& self, R& product, Args&&... args)
+			{
+				return create_as<Abstract>(
+					is_creatable_as<R, Interface<Abstract>, Abstract, Args...>{},
+					self,
+					product,
+					std::forward<Args>(args)...
+				);
+			}
+
+			template<typename Abstract, typename R, typename... Args>
+			static bool create_as(std::true_type, basic_abstract_factory& self, R& product,
+				Args&&... args)
+			{
+				Interface<Abstract>* creator = &self;
+
+				product = R(creator->create(
+					type_identity<Abstract>{}, std::forward<Args>(args)...
+				));
+				return true;
+			}
+
+			template<typename Abstract, typename R, typename... Args>
+			static bool create_as(std::false_type, basic_abstract_factory&, R&, Args&&...)
+			{
+				return false;
+			}
+		};
+	} // namespace utils
+
+	template<
+		typename AbstractList,
+		template<typename...>class Creator = default_abstract_creator
+	>
+	class abstract_factory;
+
+	template<typename... AbstractList, template<typename...>class Creator>
+	class abstract_factory<utils::tl<AbstractList...>, Creator>
+		: public utils::basic_abstract_factory<
+			utils::tl<AbstractList...>, Creator, Creator<AbstractList>...
+		>
+	{
+	public:
+		using interface_list = utils::tl<Creator<AbstractList>...>;
+	};
+
+	namespace utils
+	{
+		template<typename Context, typename, typename Base>
+		using interface_level = creator_interface_t<Context, Base>;
+
+		// creator interfaces stacked into a single inheritance chain, see
+		// compact_abstract_factory
+		template<template<typename...>class Creator, typename... Contexts>
+		struct linear_interfaces
+		{
+			using type = typename generate_creators<
+				interface_level,
+				creator_interface_root,
+				tl<Contexts...>,
+				tl<Contexts...>
+			>::type;
+
+			// level of the chain that creates Abstract, Creator<Abstract>
+			// for unknown products so that front end reports them
+			template<typename Abstract,
+				typename Level = typename find_creator<
+					Abstract,
+					interface_level,
+					creator_interface_root,
+					tl<Contexts...>,
+					tl<Contexts...>
+				>::type
+			>
+			struct find_level
+			{
+				using type = typename std::conditional<
+					std::is_void<Level>::value, Creator<Abstract>, Level
+				>::type;
+			};
+
+			template<typename Abstract>
+			using level = typename find_level<Abstract>::type;
+		};
+	} // namespace utils
+
+	// abstract factory with a single vtable pointer: creator interfaces are
+	// stacked into one inheritance chain instead of being separate bases,
+	// vtable slots follow the order of context_list
+	template<
+		typename AbstractList,
+		template<typename...>class Creator = default_abstract_creator
+	>
+	class compact_abstract_factory;
+
+	template<typename... AbstractList, template<typename...>class Creator>
+	class compact_abstract_factory<utils::tl<AbstractList...>, Creator>
+		: public utils::basic_abstract_factory<
+			utils::tl<AbstractList...>,
+			utils::linear_interfaces<
+				Creator, typename Creator<AbstractList>::context...
+			>::template level,
+			typename utils::linear_interfaces<
+				Creator, typename Creator<AbstractList>::context...
+			>::type
+		>
+	{
+	};
+
+	namespace utils
+	{
+		// builds creators as a single inheritance chain
+		template<
+			template<typename...>class Creator,
+			typename Root,
+			typename Contexts,
+			typename Concretes
+		>
+		struct chain_generator
+		{
+			using type = typename generate_creators<
+				Creator, Root, Contexts, Concretes
+			>::type;
+
+			using concrete_list = Concretes;
+
+			template<typename Abstract>
+			using creator = typename find_creator<
+				Abstract, Creator, Root, Contexts, Concretes
+			>::type;
+		};
+
+		template<
+			template<typename...>class Creator,
+			typename Root,
+			typename Contexts,
+			typename Interfaces,
+			typename Concretes,
+			typename = void
+		>
+		struct flat_creators
+		{
+			static_assert(sizeof(Root) == 0,
+				"Abstract and concrete lists are of different length");
+		};
+
+		template<
+			template<typename...>class Creator,
+			typename Root,
+			typename... Contexts,
+			typename... Interfaces,
+			typename... Concretes
+		>
+		struct flat_creators<
+			Creator,
+			Root,
+			utils::tl<Contexts...>,
+			utils::tl<Interfaces...>,
+			utils::tl<Concretes...>,
+			typename std::enable_if<
+				sizeof...(Contexts) == sizeof...(Concretes)
+			>::type
+		>
+			: public Root, public Creator<Contexts, Concretes, Interfaces>...
+		{
+		};
+
+		template<typename Abstract, typename Creator>
+		struct flat_entry
+		{
+		};
+
+		template<typename... Entries>
+		struct flat_index : public Entries...
+		{
+		};
+
+		template<typename Abstract, typename Creator>
+		utils::type_identity<Creator> flat_lookup(flat_entry<Abstract, Creator>*);
+
+		template<typename Abstract, typename Index, typename = utils::void_t<>>
+		struct flat_find
+		{
+			using type = void;
+		};
+
+		template<typename Abstract, typename Index>
+		struct flat_find<Abstract, Index, utils::void_t<
+			decltype(flat_lookup<Abstract>(static_cast<Index*>(nullptr)))
+		>>
+		{
+			using type = typename decltype(
+				flat_lookup<Abstract>(static_cast<Index*>(nullptr))
+			)::type;
+		};
+
+		// puts all creators side by side as bases of one class, so neither
+		// generation nor lookup recurses over the product list. Interfaces
+		// must be inherited virtually, see virtual_creator_interface
+		template<
+			template<typename...>class Creator,
+			typename Root,
+			typename Contexts,
+			typename Interfaces,
+			typename Concretes
+		>
+		struct flat_generator;
+
+		template<
+			template<typename...>class Creator,
+			typename Root,
+			typename... Contexts,
+			typename... Interfaces,
+			typename... Concretes
+		>
+		struct flat_generator<
+			Creator,
+			Root,
+			utils::tl<Contexts...>,
+			utils::tl<Interfaces...>,
+			utils::tl<Concretes...>
+		>
+		{
+			using type = flat_creators<
+				Creator,
+				Root,
+				utils::tl<Contexts...>,
+				utils::tl<Interfaces...>,
+				utils::tl<Concretes...>
+			>;
+
+			using concrete_list = utils::tl<Concretes...>;
+
+			template<typename Abstract>
+			using creator = typename flat_find<
+				Abstract,
+				flat_index<flat_entry<
+					typename context_abstract<Contexts>::type,
+					Creator<Contexts, Concretes, Interfaces>
+				>...>
+			>::type;
+		};
+	} // namespace utils
+
+	// concrete factory built from creators produced by Generator, see
+	// utils::chain_generator and utils::flat_generator
+	template<typename Generator, typename AbstractFactory>
+	class basic_concrete_factory : public Generator::type
+	{
+		template<typename Abstract>
+		using creator_t = typename Generator::template creator<Abstract>;
+
+	public:
+		// resolves concrete creator at compile time and calls it without
+		// virtual dispatch when its create() is accessible, otherwise falls
+		// back to abstract_factory::create()
+		template<typename Abstract, typename... Args,
+			typename = typename std::enable_if<utils::is_static_creatable<
+				creator_t<Abstract>, Abstract, Args...
+			>::value>::type
+		>
+		auto create(Args&& ...args) ->
+			decltype(utils::static_create<creator_t<Abstract>, Abstract>(
+				std::declval<creator_t<Abstract>&>(), std::forward<Args>(args)...)
+			)
+		{
+			return utils::static_create<creator_t<Abstract>, Abstract>(
+				*this, std::forward<Args>(args)...
+			);
+		}
+
+		template<typename Abstract, typename... Args,
+			typename = typename std::enable_if<!utils::is_static_creatable<
+				creator_t<Abstract>, Abstract, Args...
+			>::value>::type,
+			typename = void
+		>
+		auto create(Args&& ...args) ->
+			decltype(std::declval<AbstractFactory&>().template create<Abstract>(
+				std::forward<Args>(args)...)
+			)
+		{
+			AbstractFactory& factory = *this;
+
+			return factory.template create<Abstract>(std::forward<Args>(args)...);
+		}
+
+		template<typename Abstract, typename... Args>
+		auto create_n(std::size_t count, Args&& ...args) ->
+			decltype(std::declval<AbstractFactory&>().template create_n<Abstract>(
+				count, std::forward<Args>(args)...)
+			)
+		{
+			AbstractFactory& factory = *this;
+
+			return factory.template create_n<Abstract>(
+				count, std::forward<Args>(args)...
+			);
+		}
+
+		template<typename Abstract, typename... Args>
+		auto create_at(void* storage, std::size_t size, Args&& ...args) ->
+			decltype(std::declval<AbstractFactory&>().template create_at<Abstract>(
+				storage, size, std::forward<Args>(args)...)
+			)
+		{
+			AbstractFactory& factory = *this;
+
+			return factory.template create_at<Abstract>(
+				storage, size, std::forward<Args>(args)...
+			);
+		}
+
+		template<typename Abstract>
+		storage_requirements storage_for() const
+		{
+			const AbstractFactory& factory = *this;
+
+			return factory.template storage_for<Abstract>();
+		}
+
+		// storage that fits product built by create_at<Abstract>(), known
+		// at compile time for library creators
+		template<typename Abstract>
+		using storage_t = typename creator_t<Abstract>::storage_type;
+
+		// prepares count products of Abstract ahead of first requests:
+		// pool_concrete_creator and cached_pool_concrete_creator reserve
+		// memory and touch its pages, recycling creators construct products
+		// from args
+		template<typename Abstract, typename... Args>
+		void prewarm(std::size_t count, Args&& ...args)
+		{
+			static_assert(utils::is_prewarmable<creator_t<Abstract>, Abstract, Args&&...>::value,
+				"basic_concrete_factory::prewarm(): creator can't prewarm products from given arguments"
+			);
+
+			utils::prewarm_creator<creator_t<Abstract>, Abstract>(
+				*this, count, std::forward<Args>(args)...
+			);
+		}
+
+		// prewarm() for every product whose creator supports it without
+		// arguments, other products are skipped
+		void prewarm_all(std::size_t count)
+		{
+			prewarm_each(
+				utils::type_identity<typename AbstractFactory::context_list>{}, count
+			);
+		}
+
+	private:
+		template<typename... Contexts>
+		void prewarm_each(utils::type_identity<utils::tl<Contexts...>>, std::size_t count)
+		{
+			const int expand[] = { 0, (prewarm_if(
+				utils::is_prewarmable<
+					creator_t<typename utils::context_abstract<Contexts>::type>,
+					typename utils::context_abstract<Contexts>::type
+				>{},
+				utils::type_identity<typename utils::context_abstract<Contexts>::type>{},
+				count
+			), 0)... };
+			(void)expand;
+		}
+
+		template<typename Abstract>
+		void prewarm_if(std::true_type, utils::type_identity<Abstract>, std::size_t count)
+		{
+			prewarm<Abstract>(count);
+		}
+
+		template<typename Abstract>
+		void prewarm_if(std::false_type, utils::type_identity<Abstract>, std::size_t)
+		{
+		}
+	};
+
+	template<
+		typename AbstractFactory,
+		typename ConcreteList,
+		template<typename...>class Creator = default_concrete_creator,
+		typename Root = AbstractFactory
+	>
+	class concrete_factory
+		: public basic_concrete_factory<
+			utils::chain_generator<
+				Creator,
+				Root,
+				typename AbstractFactory::context_list,
+				ConcreteList
+			>,
+			AbstractFactory
+		>
+	{
+	};
+
+	// same as concrete_factory but creators are not chained, which keeps
+	// template instantiation depth and symbol names independent of the
+	// number of products. Requires abstract factory with virtually inherited
+	// creator interfaces, e.g. abstract_factory<..., flat_abstract_creator>
+	template<
+		typename AbstractFactory,
+		typename ConcreteList,
+		template<typename...>class Creator = default_concrete_creator
+	>
+	class flat_concrete_factory
+		: public basic_concrete_factory<
+			utils::flat_generator<
+				Creator,
+				AbstractFactory,
+				typename AbstractFactory::context_list,
+				typename AbstractFactory::interface_list,
+				ConcreteList
+			>,
+			AbstractFactory
+		>
+	{
+	};
+
+	// concrete factory bound to a memory resource, resource can be rebound
+	// at any time, products remember the resource they came from
+	template<
+		typename AbstractFactory,
+		typename ConcreteList,
+		template<typename...>class Creator = resource_concrete_creator
+	>
+	class resource_concrete_factory
+		: public concrete_factory<
+			AbstractFactory,
+			ConcreteList,
+			Creator,
+			memory_resource_root<AbstractFactory>
+		>
+	{
+	public:
+		explicit resource_concrete_factory(
+			memory_resource* resource = get_default_resource())
+		{
+			this->set_memory_resource(resource);
+		}
+	};
+
+	// concrete factory that owns monotonic arena and bump-allocates products
+	// from it. reset() releases all products memory at once so all products
+	// must be already destroyed by that time
+	template<
+		typename AbstractFactory,
+		typename ConcreteList,
+		template<typename...>class Creator = arena_concrete_creator
+	>
+	class arena_concrete_factory
+		: public resource_concrete_factory<AbstractFactory, ConcreteList, Creator>
+	{
+	public:
+		explicit arena_concrete_factory(std::size_t initialSize = 4096,
+			memory_resource* upstream = get_default_resource())
+			: arena{ initialSize, upstream }
+		{
+			this->set_memory_resource(&arena);
+		}
+
+		void reset() noexcept
+		{
+			arena.reset();
+		}
+
+	private:
+		monotonic_arena arena;
 	};
 } // namespace generic_abstract_factory
 
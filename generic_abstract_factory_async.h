@@ -0,0 +1,259 @@
+﻿#ifndef GENERIC_ABSTRACT_FACTORY_ASYNC_H
+#define GENERIC_ABSTRACT_FACTORY_ASYNC_H
+
+// asynchronous creation: executors, thread_pool, create_async<>() and
+// prewarm_all_async(). It's a separate header, so translation units that
+// don't create products asynchronously don't pay for <future>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "generic_abstract_factory.h"
+
+namespace generic_abstract_factory
+{
+	// fixed number of worker threads running tasks in submission order,
+	// destructor waits until queued tasks are done
+	class thread_pool
+	{
+	public:
+		explicit thread_pool(std::size_t threads = std::thread::hardware_concurrency())
+		{
+			try
+			{
+				do
+				{
+					workers.emplace_back([this] { work(); });
+				} while (workers.size() < threads);
+			}
+			catch (...)
+			{
+				stop();
+				throw;
+			}
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		~thread_pool()
+		{
+			stop();
+		}
+
+		void execute(std::function<void()> task)
+		{
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				tasks.push_back(std::move(task));
+			}
+			wakeup.notify_one();
+		}
+
+	private:
+		void work()
+		{
+			for (;;)
+			{
+				std::function<void()> task;
+				{
+					std::unique_lock<std::mutex> lock{ mutex };
+					wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+					if (tasks.empty())
+					{
+						return;
+					}
+					task = std::move(tasks.front());
+					tasks.pop_front();
+				}
+				task();
+			}
+		}
+
+		void stop() noexcept
+		{
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				stopping = true;
+			}
+			wakeup.notify_all();
+			for (auto& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		std::deque<std::function<void()>> tasks;
+		bool stopping{};
+		std::vector<std::thread> workers;
+	};
+
+	// executor of create_async() calls that don't specify one
+	inline thread_pool& default_thread_pool()
+	{
+		static thread_pool pool;
+		return pool;
+	}
+
+	namespace utils
+	{
+		template<typename Void, typename...>
+		struct is_executor_impl : public std::false_type
+		{
+		};
+
+		template<typename Executor>
+		struct is_executor_impl<
+			void_t<decltype(std::declval<Executor&>().execute(
+				std::declval<std::function<void()>>()))>,
+			Executor
+		>
+			: public std::true_type
+		{
+		};
+
+		// anything with execute(std::function<void()>), e.g. thread_pool
+		template<typename Executor>
+		struct is_executor
+			: public is_executor_impl<void, typename std::decay<Executor>::type>
+		{
+		};
+
+		template<typename...>
+		struct starts_with_executor : public std::false_type
+		{
+		};
+
+		template<typename T, typename... Ts>
+		struct starts_with_executor<T, Ts...> : public is_executor<T>
+		{
+		};
+
+		// arguments of create_async() stored until the task runs
+		template<typename Factory, typename Abstract, typename Ret, typename... Args>
+		class async_task
+		{
+		public:
+			template<typename... Ts>
+			async_task(Factory& factory, Ts&&... args)
+				: factory{ factory }, arguments(std::forward<Ts>(args)...)
+			{
+			}
+
+			std::future<Ret> get_future()
+			{
+				return promise.get_future();
+			}
+
+			void run()
+			{
+				run(make_index_sequence<sizeof...(Args)>{});
+			}
+
+		private:
+			template<std::size_t... Is>
+			void run(index_sequence<Is...>)
+			{
+				try
+				{
+					promise.set_value(factory.template create<Abstract>(
+						std::move(std::get<Is>(arguments))...
+					));
+				}
+				catch (...)
+				{
+					promise.set_exception(std::current_exception());
+				}
+			}
+
+			Factory& factory;
+			std::tuple<Args...> arguments;
+			std::promise<Ret> promise;
+		};
+	} // namespace utils
+
+	// runs factory.create<Abstract>() on executor, see utils::is_executor,
+	// and returns future of the product. Works with abstract and concrete
+	// factories. Arguments are moved into the task, pass std::ref() to share
+	// caller's objects. Factory has to outlive the task
+	template<typename Abstract, typename Factory, typename Executor, typename... Args,
+		typename = typename std::enable_if<
+			utils::is_executor<Executor>::value
+		>::type
+	>
+	std::future<utils::factory_ret_t<Factory, Abstract, Args...>> create_async(
+		Factory& factory, Executor&& executor, Args&& ...args)
+	{
+		using task_type = utils::async_task<
+			Factory,
+			Abstract,
+			utils::factory_ret_t<Factory, Abstract, Args...>,
+			typename std::decay<Args>::type...
+		>;
+
+		// std::function needs copyable target
+		std::shared_ptr<task_type> task = std::make_shared<task_type>(
+			factory, std::forward<Args>(args)...
+		);
+		auto result = task->get_future();
+		std::forward<Executor>(executor).execute(
+			std::function<void()>{ [task] { task->run(); } }
+		);
+		return result;
+	}
+
+	// create_async() on default_thread_pool()
+	template<typename Abstract, typename Factory, typename... Args,
+		typename = typename std::enable_if<
+			!utils::starts_with_executor<Args...>::value
+		>::type
+	>
+	std::future<utils::factory_ret_t<Factory, Abstract, Args...>> create_async(
+		Factory& factory, Args&& ...args)
+	{
+		return create_async<Abstract>(
+			factory, default_thread_pool(), std::forward<Args>(args)...
+		);
+	}
+
+	// prewarm_all() of concrete factory on executor. Factory mustn't be
+	// used until it's done unless all its prewarmed creators are
+	// thread-safe, e.g. cached_pool_concrete_creator
+	template<typename ConcreteFactory, typename Executor,
+		typename = typename std::enable_if<
+			utils::is_executor<Executor>::value
+		>::type
+	>
+	std::future<void> prewarm_all_async(ConcreteFactory& factory, Executor&& executor,
+		std::size_t count)
+	{
+		// std::function needs copyable target
+		auto task = std::make_shared<std::packaged_task<void()>>(
+			[&factory, count] { factory.prewarm_all(count); }
+		);
+		std::future<void> done = task->get_future();
+		std::forward<Executor>(executor).execute(
+			std::function<void()>{ [task] { (*task)(); } }
+		);
+		return done;
+	}
+
+	template<typename ConcreteFactory>
+	std::future<void> prewarm_all_async(ConcreteFactory& factory, std::size_t count)
+	{
+		return prewarm_all_async(factory, default_thread_pool(), count);
+	}
+} // namespace generic_abstract_factory
+
+#endif // GENERIC_ABSTRACT_FACTORY_ASYNC_H
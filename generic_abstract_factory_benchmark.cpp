@@ -0,0 +1,726 @@
+﻿#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "generic_abstract_factory.h"
+#include "generic_abstract_factory_interning.h"
+#include "generic_abstract_factory_lazy.h"
+#include "generic_abstract_factory_singleton.h"
+
+using namespace generic_abstract_factory;
+
+// counts allocations made by operator new on the current thread
+thread_local long long heapAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+	++heapAllocations;
+	if (void* p = std::malloc(size ? size : 1))
+	{
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+
+// GCC flags free() of memory from operator new once it inlines the
+// replaced operator delete
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+// product types have external linkage, otherwise compiler sees the whole
+// class hierarchy and devirtualizes calls through abstract factory
+struct IProduct
+{
+	using ret_type = block_ptr<IProduct>;
+	using ctor_args = utils::tl<int>;
+	using creation_features = utils::tl<batch_creation>;
+
+	virtual int Value() const = 0;
+	virtual ~IProduct() = default;
+};
+
+struct Product : public IProduct
+{
+	Product(int value) : value{ value }
+	{
+	}
+
+	int Value() const override
+	{
+		return value;
+	}
+
+	int value;
+	char payload[48];
+};
+
+using IUniqueProduct = utils::make_factory_interface<
+	IProduct, std::unique_ptr<IProduct>, utils::tl<int>
+>;
+using ISharedProduct = utils::make_factory_interface<
+	IProduct, std::shared_ptr<IProduct>, utils::tl<int>
+>;
+using IRawProduct = utils::make_factory_interface<
+	IProduct, IProduct*, utils::tl<int>
+>;
+
+using AFactory = abstract_factory<
+	utils::tl<IProduct, IUniqueProduct, ISharedProduct, IRawProduct>
+>;
+using HeapCFactory = concrete_factory<
+	AFactory, utils::tl<Product, Product, Product, Product>
+>;
+using PoolAFactory = abstract_factory<utils::tl<IProduct>>;
+using PoolCFactory = concrete_factory<
+	PoolAFactory, utils::tl<Product>, pool_concrete_creator
+>;
+using HeapPoolCFactory = concrete_factory<PoolAFactory, utils::tl<Product>>;
+using CachedPoolCFactory = concrete_factory<
+	PoolAFactory, utils::tl<Product>, cached_pool_concrete_creator
+>;
+using CountedPoolCFactory = concrete_factory<
+	PoolAFactory, utils::tl<Product>, instrument<pool_concrete_creator>::creator
+>;
+using TimedPoolCFactory = concrete_factory<
+	PoolAFactory,
+	utils::tl<Product>,
+	instrument<pool_concrete_creator, latency_instrumentation>::creator
+>;
+
+using SharedAFactory = abstract_factory<utils::tl<ISharedProduct>>;
+using SharedCFactory = concrete_factory<SharedAFactory, utils::tl<Product>>;
+using InterningCFactory = concrete_factory<
+	SharedAFactory, utils::tl<Product>, interning_concrete_creator
+>;
+using SingletonCFactory = concrete_factory<
+	SharedAFactory, utils::tl<Product>, singleton_concrete_creator
+>;
+using ThreadLocalCFactory = concrete_factory<
+	SharedAFactory, utils::tl<Product>, thread_local_concrete_creator
+>;
+
+using IInlineProduct = utils::make_factory_interface<
+	IProduct, inplace_poly<IProduct, sizeof(Product)>, utils::tl<int>
+>;
+using InlineAFactory = abstract_factory<utils::tl<IInlineProduct>>;
+using InlineCFactory = concrete_factory<InlineAFactory, utils::tl<Product>>;
+
+struct IPrototype
+{
+	virtual std::unique_ptr<IPrototype> Clone() const = 0;
+	virtual int Value() const = 0;
+	virtual ~IPrototype() = default;
+};
+
+struct Prototype : public IPrototype
+{
+	Prototype(int value) : value{ value }
+	{
+	}
+
+	std::unique_ptr<IPrototype> Clone() const override
+	{
+		return std::unique_ptr<IPrototype>{ new Prototype(value) };
+	}
+
+	int Value() const override
+	{
+		return value;
+	}
+
+	int value;
+};
+
+template<typename Counter>
+struct ICountedProduct : public ref_counted<Counter>
+{
+	using ret_type = intrusive_ptr<ICountedProduct>;
+	using ctor_args = utils::tl<int>;
+
+	virtual int Value() const = 0;
+};
+
+template<typename Counter>
+struct CountedProduct : public ICountedProduct<Counter>
+{
+	CountedProduct(int value) : value{ value }
+	{
+	}
+
+	int Value() const override
+	{
+		return value;
+	}
+
+	int value;
+	char payload[48];
+};
+
+using CountedAFactory = abstract_factory<utils::tl<
+	ICountedProduct<atomic_ref_count>, ICountedProduct<local_ref_count>
+>>;
+using CountedCFactory = concrete_factory<CountedAFactory, utils::tl<
+	CountedProduct<atomic_ref_count>, CountedProduct<local_ref_count>
+>>;
+
+// products that are plain values, created without allocation
+struct IValue
+{
+	using ret_type = long long;
+	using ctor_args = utils::tl<int>;
+};
+
+template<typename Context, typename Concrete, typename Base>
+class value_concrete_creator;
+
+template<typename Abstract, typename Concrete, typename Base, typename Ret, typename Arg>
+class value_concrete_creator<utils::tl<Abstract, Ret, utils::tl<Arg>>, Concrete, Base>
+	: public Base
+{
+public:
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+	Ret create(utils::type_identity<Abstract>, Arg arg) override
+	{
+		return arg;
+	}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+};
+
+using ValueAFactory = abstract_factory<utils::tl<IValue>>;
+using ValueCFactory = concrete_factory<
+	ValueAFactory, utils::tl<IValue>, value_concrete_creator
+>;
+
+using PrototypeAFactory = abstract_factory<utils::tl<IPrototype>>;
+using PrototypeCFactory = concrete_factory<
+	PrototypeAFactory, utils::tl<IPrototype>, prototype_concrete_creator
+>;
+
+namespace
+{
+	constexpr int iterations = 10000000;
+
+	// hides dynamic type of the factory from the optimizer, so that calls
+	// through abstract factory stay virtual as in real code
+	template<typename T>
+	T& opaque(T& value)
+	{
+		T* volatile pointer = &value;
+		return *pointer;
+	}
+
+#if defined(__linux__)
+	// user space instructions retired by the current thread, unavailable
+	// if perf events are restricted by perf_event_paranoid or a sandbox
+	class instruction_counter
+	{
+	public:
+		instruction_counter()
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+
+		~instruction_counter()
+		{
+			if (available())
+			{
+				close(fd);
+			}
+		}
+
+		instruction_counter(const instruction_counter&) = delete;
+		instruction_counter& operator=(const instruction_counter&) = delete;
+
+		bool available() const noexcept
+		{
+			return fd != -1;
+		}
+
+		void start() noexcept
+		{
+			if (available())
+			{
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+
+		long long stop() noexcept
+		{
+			long long count = 0;
+			if (available())
+			{
+				ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+				if (read(fd, &count, sizeof(count)) != sizeof(count))
+				{
+					count = 0;
+				}
+			}
+			return count;
+		}
+
+	private:
+		int fd;
+	};
+#else
+	class instruction_counter
+	{
+	public:
+		bool available() const noexcept
+		{
+			return false;
+		}
+
+		void start() noexcept
+		{
+		}
+
+		long long stop() noexcept
+		{
+			return 0;
+		}
+	};
+#endif
+
+	template<typename Fn>
+	void run(const char* name, Fn&& fn)
+	{
+		static instruction_counter instructions;
+
+		// warm up caches and pools before measuring
+		fn(iterations / 10);
+
+		const long long allocations = heapAllocations;
+		instructions.start();
+		const auto start = std::chrono::steady_clock::now();
+		const long long checksum = fn(iterations);
+		const auto stop = std::chrono::steady_clock::now();
+		const long long instructionCount = instructions.stop();
+
+		const double ns = static_cast<double>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()
+		);
+		const double allocationsPerOp =
+			static_cast<double>(heapAllocations - allocations) / iterations;
+		if (instructions.available())
+		{
+			std::printf("%-40s %8.2f ns/op %6.2f allocs/op %8.1f instr/op  (checksum %lld)\n",
+				name, ns / iterations, allocationsPerOp,
+				static_cast<double>(instructionCount) / iterations, checksum);
+		}
+		else
+		{
+			std::printf("%-40s %8.2f ns/op %6.2f allocs/op %8s instr/op  (checksum %lld)\n",
+				name, ns / iterations, allocationsPerOp, "n/a", checksum);
+		}
+	}
+
+	template<typename Abstract = IProduct, typename Factory>
+	long long create_destroy(Factory& factory, int count)
+	{
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			auto product = factory.template create<Abstract>(i);
+			checksum += product->Value();
+		}
+		return checksum;
+	}
+
+	constexpr int copiesPerProduct = 4;
+
+	template<typename Abstract, typename Factory>
+	long long create_copy_destroy(Factory& factory, int count)
+	{
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			auto product = factory.template create<Abstract>(i);
+			for (int j = 0; j != copiesPerProduct; ++j)
+			{
+				auto copy = opaque(product);
+				checksum += copy->Value();
+			}
+		}
+		return checksum;
+	}
+
+	template<typename Factory>
+	long long create_destroy_raw(Factory& factory, int count)
+	{
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			IProduct* product = factory.template create<IRawProduct>(i);
+			checksum += product->Value();
+			delete product;
+		}
+		return checksum;
+	}
+
+	// baselines for creators that allocate with new, opaque() keeps
+	// compiler from eliding the allocation
+	template<typename Ptr>
+	long long new_delete(int count)
+	{
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			Ptr product{ new Product(i) };
+			checksum += opaque(product)->Value();
+		}
+		return checksum;
+	}
+
+	long long new_delete_raw(int count)
+	{
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			IProduct* product = new Product(i);
+			checksum += opaque(product)->Value();
+			delete product;
+		}
+		return checksum;
+	}
+
+	constexpr int distinctArguments = 64;
+
+	// products are kept alive by a cache of the last distinctArguments
+	// ones, as by holders of configs or codecs, and requested repeatedly
+	template<typename Factory>
+	long long create_repeated(Factory& factory, int count)
+	{
+		std::shared_ptr<IProduct> alive[distinctArguments];
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			auto& slot = alive[i % distinctArguments];
+			slot = factory.template create<ISharedProduct>(i % distinctArguments);
+			checksum += slot->Value();
+		}
+		return checksum;
+	}
+
+	constexpr int batchSize = 100;
+
+	template<typename Factory>
+	long long create_destroy_batches(Factory& factory, int count)
+	{
+		long long checksum = 0;
+		for (int i = 0; i != count; i += batchSize)
+		{
+			auto batch = factory.template create_n<IProduct>(batchSize, i);
+			checksum += batch.back()->Value();
+		}
+		return checksum;
+	}
+
+	constexpr int operationsPerThread = 1000000;
+	constexpr int liveProducts = 16;
+
+	// every thread keeps a window of live products and replaces the oldest
+	// one on each step, returns millions of create/destroy pairs per second
+	double thread_scaling(PoolAFactory& factory, unsigned threadCount)
+	{
+		std::atomic<long long> checksum{ 0 };
+		std::vector<std::thread> threads;
+
+		const auto start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i != threadCount; ++i)
+		{
+			threads.emplace_back([&] {
+				block_ptr<IProduct> window[liveProducts];
+				long long sum = 0;
+				for (int j = 0; j != operationsPerThread; ++j)
+				{
+					block_ptr<IProduct>& slot = window[j % liveProducts];
+					slot = factory.create<IProduct>(j);
+					sum += slot->Value();
+				}
+				checksum += sum;
+			});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		const auto stop = std::chrono::steady_clock::now();
+
+		const double ns = static_cast<double>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()
+		);
+		return static_cast<double>(operationsPerThread) * threadCount * 1000.0 / ns;
+	}
+
+	constexpr int clonesPerReader = 1000000;
+
+	// readers clone the prototype while writer keeps replacing it
+	void prototype_swaps(unsigned readers)
+	{
+		PrototypeCFactory concreteFactory;
+		set_prototype(concreteFactory, std::unique_ptr<IPrototype>{ new Prototype(0) });
+		PrototypeAFactory& factory = opaque<PrototypeAFactory>(concreteFactory);
+
+		std::atomic<unsigned> running{ readers };
+		std::atomic<long long> checksum{ 0 };
+		std::vector<std::thread> threads;
+		long long swaps = 0;
+
+		const auto start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i != readers; ++i)
+		{
+			threads.emplace_back([&] {
+				long long sum = 0;
+				for (int j = 0; j != clonesPerReader; ++j)
+				{
+					sum += factory.create<IPrototype>()->Value();
+				}
+				checksum += sum;
+				--running;
+			});
+		}
+
+		while (running.load() != 0)
+		{
+			set_prototype(concreteFactory,
+				std::unique_ptr<IPrototype>{ new Prototype(static_cast<int>(++swaps % 100)) }
+			);
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		const auto stop = std::chrono::steady_clock::now();
+
+		const double ns = static_cast<double>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()
+		);
+		const double clones = static_cast<double>(clonesPerReader) * readers;
+		std::printf("%2u readers %29.2f Mclones/s, %lld swaps  (checksum %lld)\n",
+			readers, clones * 1000.0 / ns, swaps, checksum.load());
+	}
+} // namespace
+
+int main()
+{
+	// libstdc++ skips atomic shared_ptr updates until the process starts
+	// a thread, benchmark measures them as in multithreaded services
+	std::thread{ [] {} }.join();
+
+	HeapCFactory heapFactory;
+	PoolCFactory poolFactory;
+	CountedPoolCFactory countedPoolFactory;
+	TimedPoolCFactory timedPoolFactory;
+	InlineCFactory inlineFactory;
+	ValueCFactory valueFactory;
+	CountedCFactory countedFactory;
+	PrototypeCFactory prototypeFactory;
+	set_prototype(prototypeFactory, std::unique_ptr<IPrototype>{ new Prototype(1) });
+
+	std::printf("create/destroy, %d iterations\n", iterations);
+	std::printf("unique_ptr ret_type\n");
+	run("new", [&](int count) {
+		return new_delete<std::unique_ptr<IProduct>>(count);
+	});
+	run("default_concrete_creator, abstract", [&](int count) {
+		AFactory& factory = opaque<AFactory>(heapFactory);
+		return create_destroy<IUniqueProduct>(factory, count);
+	});
+	run("default_concrete_creator, concrete", [&](int count) {
+		return create_destroy<IUniqueProduct>(heapFactory, count);
+	});
+
+	std::printf("shared_ptr ret_type\n");
+	run("new", [&](int count) {
+		return new_delete<std::shared_ptr<IProduct>>(count);
+	});
+	run("default_concrete_creator, abstract", [&](int count) {
+		AFactory& factory = opaque<AFactory>(heapFactory);
+		return create_destroy<ISharedProduct>(factory, count);
+	});
+	run("default_concrete_creator, concrete", [&](int count) {
+		return create_destroy<ISharedProduct>(heapFactory, count);
+	});
+
+	std::printf("raw pointer ret_type\n");
+	run("new", [&](int count) {
+		return new_delete_raw(count);
+	});
+	run("default_concrete_creator, abstract", [&](int count) {
+		AFactory& factory = opaque<AFactory>(heapFactory);
+		return create_destroy_raw(factory, count);
+	});
+	run("default_concrete_creator, concrete", [&](int count) {
+		return create_destroy_raw(heapFactory, count);
+	});
+
+	std::printf("block_ptr ret_type\n");
+	run("default_concrete_creator (new)", [&](int count) {
+		AFactory& factory = opaque<AFactory>(heapFactory);
+		return create_destroy(factory, count);
+	});
+	run("pool_concrete_creator", [&](int count) {
+		PoolAFactory& factory = opaque<PoolAFactory>(poolFactory);
+		return create_destroy(factory, count);
+	});
+	run("pool_concrete_creator, counters", [&](int count) {
+		PoolAFactory& factory = opaque<PoolAFactory>(countedPoolFactory);
+		return create_destroy(factory, count);
+	});
+	run("pool_concrete_creator, latency", [&](int count) {
+		PoolAFactory& factory = opaque<PoolAFactory>(timedPoolFactory);
+		return create_destroy(factory, count);
+	});
+
+	std::printf("other ret_types\n");
+	run("inplace_poly", [&](int count) {
+		InlineAFactory& factory = opaque<InlineAFactory>(inlineFactory);
+		return create_destroy<IInlineProduct>(factory, count);
+	});
+	run("value", [&](int count) {
+		ValueAFactory& factory = opaque<ValueAFactory>(valueFactory);
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			checksum += factory.create<IValue>(i);
+		}
+		return checksum;
+	});
+	run("prototype_concrete_creator", [&](int count) {
+		PrototypeAFactory& factory = opaque<PrototypeAFactory>(prototypeFactory);
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			checksum += factory.create<IPrototype>()->Value();
+		}
+		return checksum;
+	});
+
+	std::printf("lazy products\n");
+	run("create_lazy, never accessed", [&](int count) {
+		AFactory& factory = opaque<AFactory>(heapFactory);
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			auto product = create_lazy<IUniqueProduct>(factory, i);
+			checksum += opaque(product).created() ? 1 : 0;
+		}
+		return checksum;
+	});
+	run("create_lazy, accessed", [&](int count) {
+		AFactory& factory = opaque<AFactory>(heapFactory);
+		long long checksum = 0;
+		for (int i = 0; i != count; ++i)
+		{
+			auto product = create_lazy<IUniqueProduct>(factory, i);
+			checksum += opaque(product)->Value();
+		}
+		return checksum;
+	});
+
+	std::printf("shared ownership, %d copies of every product\n", copiesPerProduct);
+	run("std::shared_ptr", [&](int count) {
+		AFactory& factory = opaque<AFactory>(heapFactory);
+		return create_copy_destroy<ISharedProduct>(factory, count);
+	});
+	run("intrusive_ptr, atomic_ref_count", [&](int count) {
+		CountedAFactory& factory = opaque<CountedAFactory>(countedFactory);
+		return create_copy_destroy<ICountedProduct<atomic_ref_count>>(factory, count);
+	});
+	run("intrusive_ptr, local_ref_count", [&](int count) {
+		CountedAFactory& factory = opaque<CountedAFactory>(countedFactory);
+		return create_copy_destroy<ICountedProduct<local_ref_count>>(factory, count);
+	});
+
+	SharedCFactory sharedFactory;
+	InterningCFactory interningFactory;
+	std::printf("repeated requests with %d distinct arguments\n", distinctArguments);
+	run("default_concrete_creator", [&](int count) {
+		return create_repeated(opaque<SharedAFactory>(sharedFactory), count);
+	});
+	run("interning_concrete_creator", [&](int count) {
+		return create_repeated(opaque<SharedAFactory>(interningFactory), count);
+	});
+
+	SingletonCFactory singletonFactory;
+	ThreadLocalCFactory threadLocalFactory;
+	std::printf("singletons, shared_ptr ret_type\n");
+	run("singleton_concrete_creator", [&](int count) {
+		return create_destroy<ISharedProduct>(opaque<SharedAFactory>(singletonFactory), count);
+	});
+	run("thread_local_concrete_creator", [&](int count) {
+		return create_destroy<ISharedProduct>(opaque<SharedAFactory>(threadLocalFactory), count);
+	});
+
+	std::printf("create_n/destroy in batches of %d\n", batchSize);
+	run("default_concrete_creator (new)", [&](int count) {
+		return create_destroy_batches(heapFactory, count);
+	});
+	run("pool_concrete_creator", [&](int count) {
+		return create_destroy_batches(poolFactory, count);
+	});
+
+	HeapPoolCFactory heapPoolFactory;
+	CachedPoolCFactory cachedPoolFactory;
+	std::printf("create/destroy from many threads, %d per thread, Mops/s\n",
+		operationsPerThread);
+	std::printf("threads %30s %22s\n", "default_concrete_creator", "cached_pool_concrete_creator");
+	for (unsigned threads : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+	{
+		std::printf("%7u %30.2f %22.2f\n", threads,
+			thread_scaling(opaque<PoolAFactory>(heapPoolFactory), threads),
+			thread_scaling(opaque<PoolAFactory>(cachedPoolFactory), threads));
+	}
+
+	std::printf("prototype_concrete_creator clones during continuous swaps, %d per reader\n",
+		clonesPerReader);
+	for (unsigned readers : { 1u, 2u, 4u, 8u })
+	{
+		prototype_swaps(readers);
+	}
+
+	return 0;
+}
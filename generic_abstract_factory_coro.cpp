@@ -0,0 +1,107 @@
+﻿#include <cassert>
+#include <memory>
+#include <string>
+
+#include "generic_abstract_factory_coro.h"
+
+#define TYPE_ASSERT(variable, type) \
+	static_assert(std::is_same<decltype(variable), type>::value, \
+		"Type should be "#type)
+
+using namespace generic_abstract_factory;
+
+struct IConfig
+{
+	using ctor_args = utils::tl<std::string>;
+
+	virtual const std::string& Text() const = 0;
+	virtual ~IConfig() = default;
+};
+
+//product that loads its content by coroutine
+struct Config : public IConfig
+{
+	explicit Config(std::string text) : text{ std::move(text) }
+	{
+	}
+
+	static task<std::unique_ptr<IConfig>> create_task(std::string name)
+	{
+		co_await resume_on<thread_pool>{ default_thread_pool() };
+		co_return std::unique_ptr<IConfig>{ new Config(name + " loaded") };
+	}
+
+	const std::string& Text() const override
+	{
+		return text;
+	}
+
+	std::string text;
+};
+
+struct IWidget
+{
+	using ret_type = std::shared_ptr<IWidget>;
+	using ctor_args = utils::tl<int>;
+
+	virtual int Size() const = 0;
+	virtual ~IWidget() = default;
+};
+
+//product with plain constructor
+struct Widget : public IWidget
+{
+	explicit Widget(int size) : size{ size }
+	{
+	}
+
+	int Size() const override
+	{
+		return size;
+	}
+
+	int size;
+};
+
+using AwaitableAFactory = abstract_factory<
+	utils::tl<IConfig, IWidget>, awaitable_abstract_creator
+>;
+using AwaitableCFactory = concrete_factory<
+	AwaitableAFactory, utils::tl<Config, Widget>, coroutine_concrete_creator
+>;
+
+//factory with synchronous creators
+using AFactory = abstract_factory<utils::tl<IWidget>>;
+using CFactory = concrete_factory<AFactory, utils::tl<Widget>>;
+
+task<int> build(AwaitableAFactory& awaitableFactory, AFactory& factory)
+{
+	auto config = co_await awaitableFactory.create<IConfig>("app");
+	TYPE_ASSERT(config, std::unique_ptr<IConfig>);
+	assert(config->Text() == "app loaded");
+
+	auto widget = co_await awaitableFactory.create<IWidget>(2);
+	TYPE_ASSERT(widget, std::shared_ptr<IWidget>);
+
+	// synchronous creators are run on executor by create_task()
+	auto syncWidget = co_await create_task<IWidget>(factory, 3);
+	TYPE_ASSERT(syncWidget, std::shared_ptr<IWidget>);
+
+	co_return widget->Size() + syncWidget->Size();
+}
+
+int main()
+{
+	AwaitableCFactory awaitableConcreteFactory;
+	CFactory concreteFactory;
+
+	assert(sync_wait(build(awaitableConcreteFactory, concreteFactory)) == 5);
+
+	// tasks can also be awaited without coroutines
+	auto widgetTask = static_cast<AwaitableAFactory&>(awaitableConcreteFactory)
+		.create<IWidget>(4);
+	TYPE_ASSERT(widgetTask, task<std::shared_ptr<IWidget>>);
+	assert(sync_wait(std::move(widgetTask))->Size() == 4);
+
+	return 0;
+}
@@ -0,0 +1,345 @@
+﻿#ifndef GENERIC_ABSTRACT_FACTORY_CORO_H
+#define GENERIC_ABSTRACT_FACTORY_CORO_H
+
+// C++20 coroutine support, requires <coroutine>. Everything from
+// generic_abstract_factory.h keeps working as before
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <utility>
+#include <variant>
+
+#include "generic_abstract_factory.h"
+#include "generic_abstract_factory_async.h"
+
+namespace generic_abstract_factory
+{
+	template<typename T> class task;
+
+	namespace utils
+	{
+		template<typename T>
+		class task_promise
+		{
+			struct final_awaiter
+			{
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				std::coroutine_handle<> await_suspend(
+					std::coroutine_handle<task_promise> finished) const noexcept
+				{
+					std::coroutine_handle<> continuation = finished.promise().continuation;
+					return continuation ? continuation : std::noop_coroutine();
+				}
+
+				void await_resume() const noexcept
+				{
+				}
+			};
+
+		public:
+			task<T> get_return_object() noexcept
+			{
+				return task<T>{ std::coroutine_handle<task_promise>::from_promise(*this) };
+			}
+
+			std::suspend_always initial_suspend() const noexcept
+			{
+				return {};
+			}
+
+			final_awaiter final_suspend() const noexcept
+			{
+				return {};
+			}
+
+			template<typename U>
+			void return_value(U&& value)
+			{
+				result.template emplace<1>(std::forward<U>(value));
+			}
+
+			void unhandled_exception() noexcept
+			{
+				result.template emplace<2>(std::current_exception());
+			}
+
+			T get()
+			{
+				if (result.index() == 2)
+				{
+					std::rethrow_exception(std::get<2>(result));
+				}
+				return std::move(std::get<1>(result));
+			}
+
+			// coroutine that awaits the task, resumed when it's done
+			std::coroutine_handle<> continuation;
+
+		private:
+			std::variant<std::monostate, T, std::exception_ptr> result;
+		};
+
+		// coroutine that starts immediately and destroys itself when done
+		struct detached_task
+		{
+			struct promise_type
+			{
+				detached_task get_return_object() const noexcept
+				{
+					return {};
+				}
+
+				std::suspend_never initial_suspend() const noexcept
+				{
+					return {};
+				}
+
+				std::suspend_never final_suspend() const noexcept
+				{
+					return {};
+				}
+
+				void return_void() const noexcept
+				{
+				}
+
+				void unhandled_exception() const noexcept
+				{
+					std::terminate();
+				}
+			};
+		};
+
+		template<typename T>
+		detached_task complete(task<T> work, std::promise<T> result)
+		{
+			try
+			{
+				result.set_value(co_await work);
+			}
+			catch (...)
+			{
+				result.set_exception(std::current_exception());
+			}
+		}
+
+		template<typename Void, typename...>
+		struct has_create_task_impl : public std::false_type
+		{
+		};
+
+		template<typename Ret, typename Concrete, typename... Args>
+		struct has_create_task_impl<
+			typename std::enable_if<std::is_convertible<
+				decltype(Concrete::create_task(std::declval<Args>()...)), task<Ret>
+			>::value>::type,
+			Ret, Concrete, Args...
+		>
+			: public std::true_type
+		{
+		};
+
+		// Concrete builds itself by coroutine
+		// static task<ret_type> create_task(ctor_args...)
+		template<typename Ret, typename Concrete, typename... Args>
+		struct has_create_task : public has_create_task_impl<void, Ret, Concrete, Args...>
+		{
+		};
+	} // namespace utils
+
+	// lazily started coroutine that produces T, awaiting it starts the
+	// coroutine and resumes the awaiter when T is ready, on the thread
+	// that completed it
+	template<typename T>
+	class task
+	{
+	public:
+		using promise_type = utils::task_promise<T>;
+
+		explicit task(std::coroutine_handle<promise_type> handle) noexcept
+			: handle{ handle }
+		{
+		}
+
+		task(task&& other) noexcept
+			: handle{ std::exchange(other.handle, {}) }
+		{
+		}
+
+		task& operator=(task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (handle)
+				{
+					handle.destroy();
+				}
+				handle = std::exchange(other.handle, {});
+			}
+			return *this;
+		}
+
+		~task()
+		{
+			if (handle)
+			{
+				handle.destroy();
+			}
+		}
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+		{
+			handle.promise().continuation = awaiter;
+			return handle;
+		}
+
+		T await_resume()
+		{
+			return handle.promise().get();
+		}
+
+	private:
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	// awaiting it moves the coroutine to a thread of executor, see
+	// utils::is_executor
+	template<typename Executor>
+	class resume_on
+	{
+	public:
+		explicit resume_on(Executor& executor) noexcept
+			: executor{ executor }
+		{
+		}
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> coroutine)
+		{
+			executor.execute([coroutine] { coroutine.resume(); });
+		}
+
+		void await_resume() const noexcept
+		{
+		}
+
+	private:
+		Executor& executor;
+	};
+
+	// blocks until the task is done, for code outside of coroutines
+	template<typename T>
+	T sync_wait(task<T> work)
+	{
+		std::promise<T> result;
+		std::future<T> done = result.get_future();
+		utils::complete(std::move(work), std::move(result));
+		return done.get();
+	}
+
+	// creates product of any factory on executor, default_thread_pool() by
+	// default. Arguments are stored in the coroutine until it runs
+	template<typename Abstract, typename Factory, typename Executor, typename... Args,
+		typename = typename std::enable_if<
+			utils::is_executor<Executor>::value
+		>::type
+	>
+	auto create_task(Factory& factory, Executor& executor, Args... args)
+		-> task<decltype(factory.template create<Abstract>(std::move(args)...))>
+	{
+		co_await resume_on<Executor>{ executor };
+		co_return factory.template create<Abstract>(std::move(args)...);
+	}
+
+	template<typename Abstract, typename Factory, typename... Args,
+		typename = typename std::enable_if<
+			!utils::starts_with_executor<Args...>::value
+		>::type
+	>
+	auto create_task(Factory& factory, Args... args)
+		-> task<decltype(factory.template create<Abstract>(std::move(args)...))>
+	{
+		return create_task<Abstract>(
+			factory, default_thread_pool(), std::move(args)...
+		);
+	}
+
+	// creator interface whose create() returns task<ret_type>, so that
+	// products are created by co_await factory.create<Abstract>()
+	template<typename Abstract>
+	using awaitable_abstract_creator = abstract_creator_interface<
+		Abstract,
+		task<utils::get_ret_type_t<
+			Abstract, utils::type_identity<std::unique_ptr<Abstract>>
+		>>,
+		utils::get_ctor_args_t<Abstract>
+	>;
+
+	// concrete creator for awaitable_abstract_creator: awaits
+	// Concrete::create_task(ctor_args...) when Concrete has it, e.g. to load
+	// resources asynchronously, otherwise constructs product on
+	// default_thread_pool(). Arguments are stored in the coroutine until
+	// it runs, reference arguments have to outlive it
+	template<typename...> class coroutine_concrete_creator;
+
+	template<
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class coroutine_concrete_creator<
+		utils::tl<Abstract, task<Ret>, utils::tl<Args...>>, Concrete, Base
+	>
+		: public Base
+	{
+		static task<Ret> make(std::true_type, Args... args)
+		{
+			return Concrete::create_task(std::forward<Args>(args)...);
+		}
+
+		static task<Ret> make(std::false_type, Args... args)
+		{
+			static_assert(std::is_constructible<Concrete, Args...>::value,
+				"Product is not constructible from a given set of arguments");
+
+			thread_pool& executor = default_thread_pool();
+			co_await resume_on<thread_pool>{ executor };
+			co_return utils::product_builder<Ret>::template create<Concrete>(
+				std::allocator<Concrete>{}, std::forward<Args>(args)...
+			);
+		}
+
+	public:
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		task<Ret> create(utils::type_identity<Abstract>, Args... args) final
+		{
+			return make(
+				utils::has_create_task<Ret, Concrete, Args...>{},
+				std::forward<Args>(args)...
+			);
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+} // namespace generic_abstract_factory
+
+#endif // GENERIC_ABSTRACT_FACTORY_CORO_H
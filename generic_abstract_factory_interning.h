@@ -0,0 +1,235 @@
+﻿#ifndef GENERIC_ABSTRACT_FACTORY_INTERNING_H
+#define GENERIC_ABSTRACT_FACTORY_INTERNING_H
+
+// interning creator, products shared by equal constructor arguments. It's
+// a separate header, so translation units that don't intern products
+// don't pay for <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "generic_abstract_factory.h"
+
+namespace generic_abstract_factory
+{
+	// state of interned products of a single product type, see
+	// basic_interning_concrete_creator
+	struct interning_stats
+	{
+		std::uint64_t created;
+		// created products that returned an existing one
+		std::uint64_t shared;
+		// released products removed from the table
+		std::uint64_t evicted;
+		// products in the table, released ones included until evicted
+		std::size_t entries;
+	};
+
+	namespace utils
+	{
+		inline std::size_t hash_combine(std::size_t seed, std::size_t hash) noexcept
+		{
+			return seed ^ (hash + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+		}
+
+		template<typename... Ts, std::size_t... Is>
+		std::size_t hash_tuple(const std::tuple<Ts...>& values, index_sequence<Is...>)
+		{
+			std::size_t seed = 0;
+			using expand = int[];
+			(void)expand{ 0, (
+				seed = hash_combine(seed, std::hash<Ts>{}(std::get<Is>(values))), 0
+			)... };
+			(void)values;
+			return seed;
+		}
+
+		// copy of constructor arguments with their hash computed once,
+		// for both choosing the stripe and the table lookup
+		template<typename... Ts>
+		struct interned_key
+		{
+			explicit interned_key(const Ts&... args)
+				: values{ args... },
+				hash{ hash_tuple(values, make_index_sequence<sizeof...(Ts)>{}) }
+			{
+			}
+
+			bool operator==(const interned_key& other) const
+			{
+				return hash == other.hash && values == other.values;
+			}
+
+			std::tuple<Ts...> values;
+			std::size_t hash;
+		};
+
+		struct interned_key_hash
+		{
+			template<typename Key>
+			std::size_t operator()(const Key& key) const noexcept
+			{
+				return key.hash;
+			}
+		};
+	} // namespace utils
+
+	// returns the alive product created from equal ctor_args instead of a
+	// new one, so immutable products are constructed once per distinct set
+	// of arguments. Requires shared_ptr ret_type and arguments with
+	// std::hash and operator==. The table keeps weak_ptrs and is split into
+	// Stripes parts with own locks: create() is thread-safe and threads
+	// creating different products rarely wait for each other. Products are
+	// constructed under the lock of their stripe, so their constructors
+	// must not create products of the same creator. Released products are
+	// evicted lazily when their stripe grows, or by evict_released().
+	// Product is allocated apart from its shared_ptr control block, so until
+	// eviction a released entry keeps only its key, table node and control
+	// block, not sizeof(Concrete). Products may outlive the factory
+	template<std::size_t Stripes, typename...> class basic_interning_concrete_creator;
+
+	template<
+		std::size_t Stripes,
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class basic_interning_concrete_creator<
+		Stripes, utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public Base
+	{
+		using element_type = utils::pointer_element_t<Ret>;
+		using key_type = utils::interned_key<typename std::decay<Args>::type...>;
+
+		static_assert(Stripes > 0, "Interning creator needs at least one stripe");
+		static_assert(std::is_constructible<Concrete, Args...>::value,
+			"Product is not constructible from a given set of arguments");
+		static_assert(utils::is_shared_ptr<Ret>::value
+				&& utils::product_builder<Ret>::template is_buildable<Concrete>::value,
+			"Interned products must have shared_ptr ret_type");
+
+		struct stripe
+		{
+			mutable std::mutex lock;
+			std::unordered_map<
+				key_type, std::weak_ptr<element_type>, utils::interned_key_hash
+			> products;
+			// table size that triggers eviction of released products
+			std::size_t evictAt{ 16 };
+			interning_stats stats{};
+		};
+
+		stripe stripes[Stripes];
+
+		static std::size_t evict(stripe& part)
+		{
+			std::size_t evicted = 0;
+			for (auto it = part.products.begin(); it != part.products.end();)
+			{
+				if (it->second.expired())
+				{
+					it = part.products.erase(it);
+					++evicted;
+				}
+				else
+				{
+					++it;
+				}
+			}
+			part.stats.evicted += evicted;
+			const std::size_t alive = part.products.size();
+			part.evictAt = alive < 8 ? 16 : alive * 2;
+			return evicted;
+		}
+
+		// not make_shared, weak_ptr in the table would keep its memory
+		template<typename... Ts>
+		static Ret make(Ts&&... args)
+		{
+			return Ret(new Concrete(std::forward<Ts>(args)...));
+		}
+	public:
+		basic_interning_concrete_creator() = default;
+		basic_interning_concrete_creator(const basic_interning_concrete_creator&) = delete;
+		basic_interning_concrete_creator& operator=(
+			const basic_interning_concrete_creator&) = delete;
+
+		friend interning_stats interning_stats_of(
+			const basic_interning_concrete_creator& self, utils::type_identity<Abstract>)
+		{
+			interning_stats result{};
+			for (const stripe& part : self.stripes)
+			{
+				std::lock_guard<std::mutex> guard{ part.lock };
+				result.created += part.stats.created;
+				result.shared += part.stats.shared;
+				result.evicted += part.stats.evicted;
+				result.entries += part.products.size();
+			}
+			return result;
+		}
+
+		// removes released products from the table, returns their count
+		friend std::size_t evict_released(basic_interning_concrete_creator& self,
+			utils::type_identity<Abstract>)
+		{
+			std::size_t evicted = 0;
+			for (stripe& part : self.stripes)
+			{
+				std::lock_guard<std::mutex> guard{ part.lock };
+				evicted += evict(part);
+			}
+			return evicted;
+		}
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args... args) final
+		{
+			key_type key{ args... };
+			stripe& part = stripes[key.hash % Stripes];
+
+			std::lock_guard<std::mutex> guard{ part.lock };
+			++part.stats.created;
+			auto found = part.products.find(key);
+			if (found != part.products.end())
+			{
+				if (Ret existing = found->second.lock())
+				{
+					++part.stats.shared;
+					return existing;
+				}
+				Ret product = make(std::forward<Args>(args)...);
+				found->second = product;
+				return product;
+			}
+
+			if (part.products.size() >= part.evictAt)
+			{
+				evict(part);
+			}
+			Ret product = make(std::forward<Args>(args)...);
+			part.products.emplace(std::move(key), product);
+			return product;
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	template<typename... Ts>
+	using interning_concrete_creator = basic_interning_concrete_creator<16, Ts...>;
+} // namespace generic_abstract_factory
+
+#endif // GENERIC_ABSTRACT_FACTORY_INTERNING_H
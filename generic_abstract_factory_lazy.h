@@ -0,0 +1,181 @@
+﻿#ifndef GENERIC_ABSTRACT_FACTORY_LAZY_H
+#define GENERIC_ABSTRACT_FACTORY_LAZY_H
+
+// lazy creation: create_lazy<>() and lazy_product. It's a separate header,
+// so translation units that create products eagerly don't pay for the
+// handle and its <tuple> of stored arguments
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "generic_abstract_factory.h"
+
+namespace generic_abstract_factory
+{
+	// handle returned by create_lazy(), keeps factory and copies of the
+	// arguments and creates product on first access. Product and arguments
+	// are stored inside the handle, so handles that are never used don't
+	// allocate. Access is thread-safe: one thread creates the product while
+	// others wait for it. Copyable arguments are passed to create() as
+	// copies, so creation that threw is retried on the next access, others
+	// are moved. Factory has to outlive the handle until product is created.
+	// Moving handle that other threads access isn't thread-safe, moved-from
+	// handle can only be destroyed
+	template<typename Factory, typename Abstract, typename Ret, typename... Args>
+	class lazy_product
+	{
+		enum state_t : unsigned char
+		{
+			empty,
+			creating,
+			ready
+		};
+
+		using copy_arguments = utils::all_of<std::is_copy_constructible<Args>::value...>;
+
+	public:
+		template<typename... Ts>
+		explicit lazy_product(Factory& factory, Ts&&... args)
+			: factory{ &factory }, arguments(std::forward<Ts>(args)...)
+		{
+		}
+
+		lazy_product(lazy_product&& other)
+			: factory{ other.factory }, arguments(std::move(other.arguments))
+		{
+			if (other.state.load(std::memory_order_relaxed) == ready)
+			{
+				::new(static_cast<void*>(&storage)) Ret(std::move(other.product()));
+				state.store(ready, std::memory_order_relaxed);
+			}
+		}
+
+		lazy_product(const lazy_product&) = delete;
+		lazy_product& operator=(const lazy_product&) = delete;
+		lazy_product& operator=(lazy_product&&) = delete;
+
+		~lazy_product()
+		{
+			if (state.load(std::memory_order_relaxed) == ready)
+			{
+				product().~Ret();
+			}
+		}
+
+		// true when product was created, doesn't create it
+		bool created() const noexcept
+		{
+			return state.load(std::memory_order_acquire) == ready;
+		}
+
+		// ret_type of the product, created by the first call
+		Ret& get() const
+		{
+			if (state.load(std::memory_order_acquire) != ready)
+			{
+				create();
+			}
+			return product();
+		}
+
+		// members of the product, operator-> of ret_type applies too
+		Ret& operator->() const
+		{
+			return get();
+		}
+
+		template<typename R = Ret>
+		auto operator*() const -> decltype(*std::declval<R&>())
+		{
+			return *get();
+		}
+
+	private:
+		Ret& product() const noexcept
+		{
+			return *static_cast<Ret*>(static_cast<void*>(&storage));
+		}
+
+		void create() const
+		{
+			for (;;)
+			{
+				unsigned char expected = empty;
+				if (state.compare_exchange_weak(expected, creating,
+					std::memory_order_acquire, std::memory_order_acquire))
+				{
+					break;
+				}
+				if (expected == ready)
+				{
+					return;
+				}
+				if (expected == creating)
+				{
+					std::this_thread::yield();
+				}
+			}
+
+			try
+			{
+				construct(copy_arguments{}, utils::make_index_sequence<sizeof...(Args)>{});
+			}
+			catch (...)
+			{
+				state.store(empty, std::memory_order_release);
+				throw;
+			}
+			state.store(ready, std::memory_order_release);
+		}
+
+		template<std::size_t... Is>
+		void construct(std::true_type, utils::index_sequence<Is...>) const
+		{
+			::new(static_cast<void*>(&storage)) Ret(factory->template create<Abstract>(
+				std::get<Is>(arguments)...
+			));
+		}
+
+		template<std::size_t... Is>
+		void construct(std::false_type, utils::index_sequence<Is...>) const
+		{
+			::new(static_cast<void*>(&storage)) Ret(factory->template create<Abstract>(
+				std::move(std::get<Is>(arguments))...
+			));
+		}
+
+		Factory* factory;
+		mutable std::tuple<Args...> arguments;
+		mutable typename std::aligned_storage<sizeof(Ret), alignof(Ret)>::type storage;
+		mutable std::atomic<unsigned char> state{ empty };
+	};
+
+	namespace utils
+	{
+		template<typename Factory, typename Abstract, typename... Args>
+		using lazy_product_t = lazy_product<
+			Factory,
+			Abstract,
+			factory_ret_t<Factory, Abstract, Args...>,
+			typename std::decay<Args>::type...
+		>;
+	} // namespace utils
+
+	// returns handle that creates factory.create<Abstract>() on first access,
+	// see lazy_product. Works with abstract and concrete factories.
+	// Arguments are stored in the handle
+	template<typename Abstract, typename Factory, typename... Args>
+	utils::lazy_product_t<Factory, Abstract, Args...> create_lazy(
+		Factory& factory, Args&& ...args)
+	{
+		return utils::lazy_product_t<Factory, Abstract, Args...>{
+			factory, std::forward<Args>(args)...
+		};
+	}
+} // namespace generic_abstract_factory
+
+#endif // GENERIC_ABSTRACT_FACTORY_LAZY_H
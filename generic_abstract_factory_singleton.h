@@ -0,0 +1,494 @@
+﻿#ifndef GENERIC_ABSTRACT_FACTORY_SINGLETON_H
+#define GENERIC_ABSTRACT_FACTORY_SINGLETON_H
+
+// singleton and thread-local singleton creators and
+// singleton_concrete_factory. It's a separate header, so translation units
+// that don't use them don't pay for <unordered_map> and their locking
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "generic_abstract_factory.h"
+
+namespace generic_abstract_factory
+{
+	namespace utils
+	{
+		// ret_type of singleton creators and holder that owns the product:
+		// raw pointer is borrowed from the creator, shared_ptr shares
+		// ownership with it, so products outlive the creator while used
+		template<typename Ret>
+		struct singleton_product : public std::false_type
+		{
+		};
+
+		template<typename T>
+		struct singleton_product<T*> : public std::true_type
+		{
+			template<typename Concrete>
+			using holder = std::unique_ptr<Concrete>;
+
+			template<typename Concrete, typename... Args>
+			static holder<Concrete> own(Args&&... args)
+			{
+				return holder<Concrete>{ new Concrete(std::forward<Args>(args)...) };
+			}
+
+			template<typename Concrete>
+			static T* make(const holder<Concrete>& product) noexcept
+			{
+				return product.get();
+			}
+		};
+
+		template<typename T>
+		struct singleton_product<std::shared_ptr<T>> : public std::true_type
+		{
+			template<typename Concrete>
+			using holder = std::shared_ptr<Concrete>;
+
+			template<typename Concrete, typename... Args>
+			static holder<Concrete> own(Args&&... args)
+			{
+				return std::make_shared<Concrete>(std::forward<Args>(args)...);
+			}
+
+			template<typename Concrete>
+			static std::shared_ptr<T> make(const holder<Concrete>& product) noexcept
+			{
+				return product;
+			}
+		};
+
+		// singleton creators of a single factory in order of creation,
+		// see singleton_concrete_factory
+		class singleton_registry
+		{
+		public:
+			using destroy_fn = void(*)(void*);
+
+			void push(void* creator, destroy_fn destroy)
+			{
+				std::lock_guard<std::mutex> guard{ lock };
+				entries.push_back(entry{ creator, destroy });
+			}
+
+			// destroys products in reverse order of creation
+			void destroy_all()
+			{
+				std::vector<entry> created;
+				{
+					std::lock_guard<std::mutex> guard{ lock };
+					created.swap(entries);
+				}
+				while (!created.empty())
+				{
+					const entry last = created.back();
+					created.pop_back();
+					last.destroy(last.creator);
+				}
+			}
+
+		private:
+			struct entry
+			{
+				void* creator;
+				destroy_fn destroy;
+			};
+
+			std::mutex lock;
+			std::vector<entry> entries;
+		};
+
+		template<typename Void, typename Base>
+		struct has_singleton_registry_impl : public std::false_type
+		{
+		};
+
+		template<typename Base>
+		struct has_singleton_registry_impl<
+			void_t<decltype(std::declval<Base&>().get_singleton_registry())>, Base
+		>
+			: public std::true_type
+		{
+		};
+
+		template<typename Base>
+		struct has_singleton_registry : public has_singleton_registry_impl<void, Base>
+		{
+		};
+	} // namespace utils
+
+	// root of singleton_concrete_factory, singleton creators register
+	// their products in it
+	template<typename AbstractFactory>
+	class singleton_registry_root : public AbstractFactory
+	{
+	public:
+		utils::singleton_registry& get_singleton_registry() noexcept
+		{
+			return registry;
+		}
+
+		// destroys products of singleton creators in reverse order of
+		// creation, next create() creates them again. Products must not be
+		// used or created meanwhile
+		void destroy_singletons()
+		{
+			registry.destroy_all();
+		}
+
+	private:
+		utils::singleton_registry registry;
+	};
+
+	// creates product on the first create() and returns it to every later
+	// call, arguments of later calls are ignored. Creation is serialized by
+	// a mutex, so product's constructor must not create the same product,
+	// created product is read by a single atomic load. ret_type is raw
+	// pointer valid until the factory is destroyed or shared_ptr that
+	// shares ownership with the creator, see utils::singleton_product.
+	// Creator releases products along with itself, singleton_concrete_factory
+	// releases them in reverse order of creation instead
+	template<typename...> class singleton_concrete_creator;
+
+	template<
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class singleton_concrete_creator<
+		utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public Base
+	{
+		static_assert(std::is_constructible<Concrete, Args...>::value,
+			"Product is not constructible from a given set of arguments");
+		static_assert(utils::singleton_product<Ret>::value,
+			"ret_type of singleton has to be raw pointer or shared_ptr");
+
+		using product_traits = utils::singleton_product<Ret>;
+		using holder = typename product_traits::template holder<Concrete>;
+
+		std::atomic<Concrete*> instance{ nullptr };
+		// written only under creation before instance is published
+		holder owned;
+		std::mutex creation;
+
+		static void destroy(void* self)
+		{
+			singleton_concrete_creator& creator = *static_cast<singleton_concrete_creator*>(self);
+			creator.instance.store(nullptr, std::memory_order_relaxed);
+			creator.owned.reset();
+		}
+
+		void enlist(std::true_type)
+		{
+			this->get_singleton_registry().push(this, &destroy);
+		}
+
+		void enlist(std::false_type)
+		{
+		}
+
+		template<typename... Ts>
+		void construct(Ts&&... args)
+		{
+			std::lock_guard<std::mutex> guard{ creation };
+			if (!instance.load(std::memory_order_relaxed))
+			{
+				holder created = product_traits::template own<Concrete>(std::forward<Ts>(args)...);
+				enlist(utils::has_singleton_registry<Base>{});
+				owned = std::move(created);
+				instance.store(owned.get(), std::memory_order_release);
+			}
+		}
+	public:
+		singleton_concrete_creator() = default;
+		singleton_concrete_creator(const singleton_concrete_creator&) = delete;
+		singleton_concrete_creator& operator=(const singleton_concrete_creator&) = delete;
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args... args) final
+		{
+			if (!instance.load(std::memory_order_acquire))
+			{
+				construct(std::forward<Args>(args)...);
+			}
+			return product_traits::make(owned);
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	namespace utils
+	{
+		// ids of creator instances are never reused, so state left by a
+		// destroyed creator can't be taken for state of a new one
+		inline std::uint64_t next_creator_id() noexcept
+		{
+			static std::atomic<std::uint64_t> last{ 0 };
+			return last.fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+	} // namespace utils
+
+	// creates product on the first create() of every thread and returns it
+	// to later calls of that thread without synchronization, arguments of
+	// later calls are ignored. Like singleton_concrete_creator, every
+	// factory has its own products. They're kept in thread_local storage of
+	// the thread and destroyed when it exits, in reverse order of creation,
+	// or when the creator is destroyed: creator erases its products from
+	// every thread that has one, so factories created and destroyed by a
+	// long-running thread don't pile them up. Shared products live while
+	// used. ret_type is the same as for singleton_concrete_creator
+	template<typename...> class thread_local_concrete_creator;
+
+	template<
+		typename Abstract,
+		typename Concrete,
+		typename Base,
+		typename Ret,
+		typename... Args
+	>
+	class thread_local_concrete_creator<
+		utils::tl<Abstract, Ret, utils::tl<Args...>>, Concrete, Base
+	>
+		: public Base
+	{
+		static_assert(std::is_constructible<Concrete, Args...>::value,
+			"Product is not constructible from a given set of arguments");
+		static_assert(utils::singleton_product<Ret>::value,
+			"ret_type of singleton has to be raw pointer or shared_ptr");
+
+		using product_traits = utils::singleton_product<Ret>;
+		using holder = typename product_traits::template holder<Concrete>;
+
+		// products of all creators of this type made by one thread, keyed
+		// by creator id. Shared by the thread and creators that have a
+		// product in it, lock guards changes and lookups by the thread.
+		// Nodes of unordered_map keep addresses of products stable
+		struct thread_products
+		{
+			std::mutex lock;
+			std::unordered_map<std::uint64_t, holder> entries;
+			// creator ids in order of creation of their products
+			std::vector<std::uint64_t> order;
+			std::atomic<bool> alive{ true };
+
+			// product is destroyed by the caller, outside of the lock
+			holder take(std::uint64_t creator)
+			{
+				holder product;
+				std::lock_guard<std::mutex> guard{ lock };
+				const auto existing = entries.find(creator);
+				if (existing == entries.end())
+				{
+					return product;
+				}
+
+				product = std::move(existing->second);
+				entries.erase(existing);
+				for (std::size_t i = 0; i != order.size(); ++i)
+				{
+					if (order[i] == creator)
+					{
+						order.erase(order.begin() + static_cast<std::ptrdiff_t>(i));
+						break;
+					}
+				}
+				return product;
+			}
+		};
+
+		// destroys products of the thread when it exits
+		struct thread_owner
+		{
+			std::shared_ptr<thread_products> products{ std::make_shared<thread_products>() };
+
+			~thread_owner()
+			{
+				last_id() = 0;
+				storage() = nullptr;
+				destroyed() = true;
+
+				std::unordered_map<std::uint64_t, holder> entries;
+				std::vector<std::uint64_t> order;
+				{
+					std::lock_guard<std::mutex> guard{ products->lock };
+					products->alive.store(false, std::memory_order_relaxed);
+					entries.swap(products->entries);
+					order.swap(products->order);
+				}
+				while (!order.empty())
+				{
+					entries.erase(order.back());
+					order.pop_back();
+				}
+			}
+		};
+
+		// trivial thread_locals, accessed without initialization checks.
+		// last() is product of the creator with last_id() used by the thread
+		static thread_products*& storage() noexcept
+		{
+			static thread_local thread_products* products = nullptr;
+			return products;
+		}
+
+		static bool& destroyed() noexcept
+		{
+			static thread_local bool gone = false;
+			return gone;
+		}
+
+		static std::uint64_t& last_id() noexcept
+		{
+			static thread_local std::uint64_t creator = 0;
+			return creator;
+		}
+
+		static const holder*& last() noexcept
+		{
+			static thread_local const holder* product = nullptr;
+			return product;
+		}
+
+		const holder& remember(const holder& product) const noexcept
+		{
+			last_id() = id;
+			last() = &product;
+			return product;
+		}
+
+		// threads that exited are dropped before the list grows, so
+		// creator used by many short-lived threads doesn't keep them all
+		void enlist(const std::shared_ptr<thread_products>& products)
+		{
+			std::lock_guard<std::mutex> guard{ lock };
+			if (threads.size() == threads.capacity())
+			{
+				std::size_t kept = 0;
+				for (std::size_t i = 0; i != threads.size(); ++i)
+				{
+					if (threads[i]->alive.load(std::memory_order_relaxed))
+					{
+						threads[kept++] = std::move(threads[i]);
+					}
+				}
+				threads.erase(threads.begin() + static_cast<std::ptrdiff_t>(kept), threads.end());
+			}
+			threads.push_back(products);
+		}
+
+		template<typename... Ts>
+		const holder& find_or_construct(Ts&&... args)
+		{
+			if (thread_products* products = storage())
+			{
+				std::lock_guard<std::mutex> guard{ products->lock };
+				const auto existing = products->entries.find(id);
+				if (existing != products->entries.end())
+				{
+					return remember(existing->second);
+				}
+			}
+
+			// constructed outside of the lock, constructor may create
+			// products of other creators
+			holder created = product_traits::template own<Concrete>(std::forward<Ts>(args)...);
+			if (destroyed())
+			{
+				// products of this thread are gone, ones created by later
+				// thread_local destructors are never destroyed
+				return remember(*new holder(std::move(created)));
+			}
+
+			// constructed after the first product, so it's destroyed before
+			// products created by product's constructor
+			static thread_local thread_owner owner;
+			storage() = owner.products.get();
+			enlist(owner.products);
+
+			std::lock_guard<std::mutex> guard{ owner.products->lock };
+			const holder& product = owner.products->entries.emplace(
+				id, std::move(created)
+			).first->second;
+			owner.products->order.push_back(id);
+			return remember(product);
+		}
+
+		const std::uint64_t id{ utils::next_creator_id() };
+		std::mutex lock;
+		std::vector<std::shared_ptr<thread_products>> threads;
+	public:
+		thread_local_concrete_creator() = default;
+		thread_local_concrete_creator(const thread_local_concrete_creator&) = delete;
+		thread_local_concrete_creator& operator=(const thread_local_concrete_creator&) = delete;
+
+		// products are destroyed outside of thread locks, their destructors
+		// may create products
+		~thread_local_concrete_creator()
+		{
+			for (const std::shared_ptr<thread_products>& products : threads)
+			{
+				products->take(id);
+			}
+		}
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Woverloaded-virtual"
+#endif
+		Ret create(utils::type_identity<Abstract>, Args... args) final
+		{
+			if (last_id() == id)
+			{
+				return product_traits::make(*last());
+			}
+			return product_traits::make(find_or_construct(std::forward<Args>(args)...));
+		}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+	};
+
+	// concrete factory whose singleton products are destroyed in reverse
+	// order of their creation, so products used by constructors of other
+	// products outlive them, see singleton_registry_root
+	template<
+		typename AbstractFactory,
+		typename ConcreteList,
+		template<typename...>class Creator = singleton_concrete_creator
+	>
+	class singleton_concrete_factory
+		: public concrete_factory<
+			AbstractFactory,
+			ConcreteList,
+			Creator,
+			singleton_registry_root<AbstractFactory>
+		>
+	{
+	public:
+		singleton_concrete_factory() = default;
+
+		// creators are destroyed after this, products go first
+		~singleton_concrete_factory()
+		{
+			this->destroy_singletons();
+		}
+	};
+} // namespace generic_abstract_factory
+
+#endif // GENERIC_ABSTRACT_FACTORY_SINGLETON_H
@@ -0,0 +1,119 @@
+﻿// checks below are the example's tests, keep them in release builds
+#undef NDEBUG
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#include "generic_abstract_factory_variant.h"
+
+#define TYPE_ASSERT(variable, type) \
+	static_assert(std::is_same<decltype(variable), type>::value, \
+		"Type should be "#type)
+
+using namespace generic_abstract_factory;
+
+//counts all allocations made by operator new
+std::atomic<int> heapAllocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+	++heapAllocations;
+	if (void* p = std::malloc(size ? size : 1))
+	{
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+
+// GCC flags free() of memory from operator new once it inlines the
+// replaced operator delete
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+struct IPooledProduct
+{
+	using ret_type = block_ptr<IPooledProduct>;
+	using ctor_args = utils::tl<int>;
+
+	virtual int Value() const = 0;
+	virtual ~IPooledProduct() = default;
+};
+
+struct PooledProduct : public IPooledProduct
+{
+	PooledProduct(int value) : value{ value }
+	{
+	}
+
+	int Value() const override
+	{
+		return value;
+	}
+
+	int value;
+};
+
+struct ISharedProduct
+{
+	using ret_type = std::shared_ptr<ISharedProduct>;
+
+	virtual ~ISharedProduct() = default;
+};
+
+struct SharedProduct : public ISharedProduct
+{
+};
+
+using AFactory = abstract_factory<utils::tl<IPooledProduct, ISharedProduct>>;
+using CFactory = variant_concrete_factory<
+	AFactory, utils::tl<PooledProduct, SharedProduct>, pool_concrete_creator
+>;
+
+int main()
+{
+	CFactory concreteFactory;
+	AFactory* abstractFactory = &concreteFactory;
+
+	// it's still a concrete factory
+	auto pooled = abstractFactory->create<IPooledProduct>(1);
+	TYPE_ASSERT(pooled, block_ptr<IPooledProduct>);
+	assert(pooled->Value() == 1);
+
+	// products can be created as values holding concrete product
+	const int allocationsBeforeVariant = heapAllocations;
+	auto pooledVariant = concreteFactory.create_variant<IPooledProduct>(9);
+	TYPE_ASSERT(pooledVariant, CFactory::variant_t);
+	assert(heapAllocations == allocationsBeforeVariant);
+	assert(pooledVariant.index() == AFactory::id_of<IPooledProduct>());
+
+	const int visited = std::visit(overloaded{
+		[](const PooledProduct& product) { return product.value; },
+		[](const SharedProduct&) { return -1; }
+	}, pooledVariant);
+	assert(visited == 9);
+	assert(product_as<IPooledProduct>(pooledVariant)->Value() == 9);
+	assert(!product_as<ISharedProduct>(pooledVariant));
+
+	const CFactory::variant_t sharedVariant =
+		concreteFactory.create_variant<ISharedProduct>();
+	assert(product_as<ISharedProduct>(sharedVariant));
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+﻿#ifndef GENERIC_ABSTRACT_FACTORY_VARIANT_H
+#define GENERIC_ABSTRACT_FACTORY_VARIANT_H
+
+// C++17 support for products held by value in std::variant, requires
+// <variant>. It's a separate header, so types from generic_abstract_factory.h
+// are the same in every translation unit regardless of its -std
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "generic_abstract_factory.h"
+
+namespace generic_abstract_factory
+{
+	namespace utils
+	{
+		template<typename List>
+		struct variant_of;
+
+		template<typename... Concretes>
+		struct variant_of<tl<Concretes...>>
+		{
+			using type = std::variant<Concretes...>;
+		};
+	} // namespace utils
+
+	// function object made of lambdas, e.g. for std::visit() of
+	// variant_concrete_factory::variant_t
+	template<typename... Fs>
+	struct overloaded : public Fs...
+	{
+		using Fs::operator()...;
+	};
+
+	template<typename... Fs>
+	overloaded(Fs...) -> overloaded<Fs...>;
+
+	// product held by variant as Abstract, nullptr if held concrete product
+	// isn't derived from it
+	template<typename Abstract, typename... Concretes>
+	Abstract* product_as(std::variant<Concretes...>& product)
+	{
+		return std::visit([](auto& concrete) -> Abstract* {
+			if constexpr (std::is_convertible_v<decltype(&concrete), Abstract*>)
+			{
+				return &concrete;
+			}
+			else
+			{
+				return nullptr;
+			}
+		}, product);
+	}
+
+	template<typename Abstract, typename... Concretes>
+	const Abstract* product_as(const std::variant<Concretes...>& product)
+	{
+		return std::visit([](const auto& concrete) -> const Abstract* {
+			if constexpr (std::is_convertible_v<decltype(&concrete), const Abstract*>)
+			{
+				return &concrete;
+			}
+			else
+			{
+				return nullptr;
+			}
+		}, product);
+	}
+
+	// concrete_factory that can also create products as values
+	template<
+		typename AbstractFactory,
+		typename ConcreteList,
+		template<typename...>class Creator = default_concrete_creator,
+		typename Root = AbstractFactory
+	>
+	class variant_concrete_factory
+		: public concrete_factory<AbstractFactory, ConcreteList, Creator, Root>
+	{
+	public:
+		// value that holds any concrete product of the factory, alternative
+		// of a product has the index of its abstract product in context_list
+		using variant_t = typename utils::variant_of<ConcreteList>::type;
+
+		// constructs concrete product of Abstract right in variant_t,
+		// without creators, heap allocation and virtual calls
+		template<typename Abstract, typename... Args>
+		variant_t create_variant(Args&& ...args)
+		{
+			return variant_t{
+				std::in_place_index<AbstractFactory::template id_of<Abstract>()>,
+				std::forward<Args>(args)...
+			};
+		}
+	};
+} // namespace generic_abstract_factory
+
+#endif // GENERIC_ABSTRACT_FACTORY_VARIANT_H